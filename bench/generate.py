@@ -0,0 +1,130 @@
+#!/usr/bin/env python
+# This file is distributed under MIT-LICENSE. See COPYING for details.
+
+"""Generates a synthetic translation unit for the scaling benchmarks.
+
+Every class derives from a chain of bases, and has member variables which
+some of its methods change. The methods declare locals which are partly
+changed, partly referring to members, and initialized by nested
+expressions. A class template is instantiated with distinct arguments.
+"""
+
+from __future__ import print_function
+
+import argparse
+import sys
+
+
+def expression(nesting, leaf):
+    result = leaf
+    for level in range(nesting):
+        result = '(({0}) {1} {2})'.format(result, '+*-'[level % 3], level + 1)
+    return result
+
+
+def base_chain(out, cls, depth):
+    parent = None
+    for level in range(depth):
+        name = 'C{0}_B{1}'.format(cls, level)
+        inherit = ' : public {0}'.format(parent) if parent else ''
+        print('struct {0}{1} {{'.format(name, inherit), file=out)
+        print('    int b{0};'.format(level), file=out)
+        print('    void touch{0}() {{ b{0} = {0}; }}'.format(level), file=out)
+        print('    int peek{0}() {{ return b{0}; }}'.format(level), file=out)
+        print('};', file=out)
+        parent = name
+    return parent
+
+
+def method(out, cls, index, args):
+    # the kind of the method rotates: changing a member, reading members
+    # only, or not touching the object at all.
+    kind = index % 3
+    print('    int method{0}(int p) {{'.format(index), file=out)
+    for local in range(args.locals):
+        if 0 == local % 3:
+            print('        int v{0} = {1};'.format(
+                local, expression(args.nesting, 'p')), file=out)
+        elif 1 == local % 3:
+            print('        int & r{0} = {1};'.format(
+                local, 'm{0}'.format(local % 4) if kind != 2 else 'p'), file=out)
+        else:
+            print('        int w{0} = {1};'.format(local, local), file=out)
+            print('        w{0} += p;'.format(local), file=out)
+    if 0 == kind:
+        print('        m{0} = p;'.format(index % 4), file=out)
+        if args.depth:
+            print('        touch{0}();'.format(index % args.depth), file=out)
+    elif 1 == kind:
+        print('        p += m{0};'.format(index % 4), file=out)
+        if args.depth:
+            print('        p += peek{0}();'.format(index % args.depth), file=out)
+    print('        return p;', file=out)
+    print('    }', file=out)
+
+
+def generate(out, args):
+    print('// generated with {0} classes, {1} methods, {2} bases deep, {3} locals,'
+          ' {4} nesting, {5} instantiations'.format(
+              args.classes, args.methods, args.depth, args.locals,
+              args.nesting, args.instantiations), file=out)
+    print('', file=out)
+    for cls in range(args.classes):
+        parent = base_chain(out, cls, args.depth)
+        inherit = ' : public {0}'.format(parent) if parent else ''
+        print('class C{0}{1} {{'.format(cls, inherit), file=out)
+        print('public:', file=out)
+        for index in range(args.methods):
+            method(out, cls, index, args)
+        print('private:', file=out)
+        for member in range(4):
+            print('    int m{0};'.format(member), file=out)
+        print('};', file=out)
+        print('', file=out)
+
+    print('template <int N>', file=out)
+    print('struct Tpl {', file=out)
+    print('    int m;', file=out)
+    print('    int get(int p) {', file=out)
+    print('        int v = {0};'.format(expression(args.nesting, 'N')), file=out)
+    print('        int w = p;', file=out)
+    print('        w += N;', file=out)
+    print('        return v + w + m;', file=out)
+    print('    }', file=out)
+    print('};', file=out)
+    print('', file=out)
+    print('int instantiate() {', file=out)
+    print('    int result = 0;', file=out)
+    for index in range(args.instantiations):
+        print('    result += Tpl<{0}>().get(result);'.format(index), file=out)
+    print('    return result;', file=out)
+    print('}', file=out)
+
+
+def functions(args):
+    """The number of function definitions the plugin analyses."""
+    return args.classes * (args.methods + 2 * args.depth) \
+        + 1 + 1 + args.instantiations
+
+
+def parser():
+    result = argparse.ArgumentParser(description=__doc__)
+    result.add_argument('--classes', type=int, default=10)
+    result.add_argument('--methods', type=int, default=10,
+                        help='methods per class')
+    result.add_argument('--depth', type=int, default=2,
+                        help='depth of the base class chains')
+    result.add_argument('--locals', type=int, default=6,
+                        help='locals per method')
+    result.add_argument('--nesting', type=int, default=3,
+                        help='nesting of the initializer expressions')
+    result.add_argument('--instantiations', type=int, default=10,
+                        help='instantiations of the class template')
+    result.add_argument('--output', type=argparse.FileType('w'),
+                        default=sys.stdout)
+    return result
+
+
+if __name__ == '__main__':
+    arguments = parser().parse_args()
+    generate(arguments.output, arguments)
@@ -0,0 +1,95 @@
+#!/usr/bin/env python
+# This file is distributed under MIT-LICENSE. See COPYING for details.
+
+"""Runs the plugin over generated translation units of growing size.
+
+Every series grows one dimension of the generated code while the others
+stay at their defaults. Each translation unit is compiled with and without
+the plugin, the difference is the cost of the analysis. The wall time is
+the best of the repeated runs, the peak RSS is measured on the child.
+"""
+
+from __future__ import print_function
+
+import argparse
+import csv
+import os
+import subprocess
+import sys
+import time
+
+import generate
+
+SERIES = [
+    ('classes', [10, 20, 40, 80]),
+    ('methods', [10, 20, 40, 80]),
+    ('depth', [1, 4, 16, 64]),
+    ('locals', [4, 16, 64, 256]),
+    ('nesting', [2, 8, 32, 128]),
+    ('instantiations', [10, 40, 160, 640]),
+]
+
+
+def measure(command, repeat):
+    """The best wall time in seconds and the peak RSS in kilobytes."""
+    best_time, peak_rss = None, 0
+    with open(os.devnull, 'w') as devnull:
+        for _ in range(repeat):
+            start = time.time()
+            child = subprocess.Popen(command, stdout=devnull, stderr=devnull)
+            _, status, usage = os.wait4(child.pid, 0)
+            elapsed = time.time() - start
+            if not os.WIFEXITED(status) or os.WEXITSTATUS(status):
+                raise RuntimeError('failed: {0}'.format(' '.join(command)))
+            best_time = elapsed if best_time is None else min(best_time, elapsed)
+            peak_rss = max(peak_rss, usage.ru_maxrss)
+    return best_time, peak_rss
+
+
+def run(args):
+    if not os.path.isdir(args.work):
+        os.makedirs(args.work)
+    baseline = [args.clang, '-cc1', '-fsyntax-only']
+    plugin = baseline + ['-load', args.plugin, '-plugin', 'constantine',
+                         '-plugin-arg-constantine', '-constantine-instantiations']
+
+    header = ['series', 'value', 'functions', 'compile_s', 'analysis_s',
+              'peak_rss_kb', 'ns_per_function']
+    writer = csv.writer(args.output)
+    writer.writerow(header)
+    print('{0:>15} {1:>6} {2:>9} {3:>10} {4:>10} {5:>12} {6:>15}'.format(*header))
+    for name, values in SERIES:
+        for value in values:
+            settings = generate.parser().parse_args(['--{0}={1}'.format(name, value)])
+            source = os.path.join(args.work, '{0}-{1}.cpp'.format(name, value))
+            with open(source, 'w') as out:
+                generate.generate(out, settings)
+
+            compile_time, _ = measure(baseline + [source], args.repeat)
+            total_time, rss = measure(plugin + [source], args.repeat)
+            analysis_time = max(total_time - compile_time, 0.0)
+            functions = generate.functions(settings)
+            row = [name, value, functions,
+                   '{0:.3f}'.format(compile_time),
+                   '{0:.3f}'.format(analysis_time),
+                   rss,
+                   '{0:.0f}'.format(analysis_time * 1e9 / functions)]
+            writer.writerow(row)
+            print('{0:>15} {1:>6} {2:>9} {3:>10} {4:>10} {5:>12} {6:>15}'.format(*row))
+            sys.stdout.flush()
+
+
+def parser():
+    result = argparse.ArgumentParser(description=__doc__)
+    result.add_argument('--clang', required=True)
+    result.add_argument('--plugin', required=True)
+    result.add_argument('--work', required=True,
+                        help='directory of the generated sources')
+    result.add_argument('--repeat', type=int, default=3)
+    result.add_argument('--output', type=argparse.FileType('w'),
+                        default=sys.stdout, help='the results as CSV')
+    return result
+
+
+if __name__ == '__main__':
+    run(parser().parse_args())
@@ -4,6 +4,7 @@
 #   CLANG_FOUND
 #   CLANG_INCLUDE_DIRS
 #   CLANG_DEFINITIONS
+#   CLANG_LIBRARIES
 #   CLANG_EXECUTABLE
 
 function(set_clang_definitions config_cmd)
@@ -60,6 +61,37 @@ function(set_clang_include_dirs config_cmd)
   set(CLANG_INCLUDE_DIRS ${include_dirs} PARENT_SCOPE)
 endfunction()
 
+function(set_clang_libraries config_cmd)
+  execute_process(
+    COMMAND ${config_cmd} --ldflags
+    OUTPUT_VARIABLE llvm_ldflags
+    OUTPUT_STRIP_TRAILING_WHITESPACE)
+  execute_process(
+    COMMAND ${config_cmd} --libs
+    OUTPUT_VARIABLE llvm_libs
+    OUTPUT_STRIP_TRAILING_WHITESPACE)
+  separate_arguments(llvm_ldflags UNIX_COMMAND "${llvm_ldflags}")
+  separate_arguments(llvm_libs UNIX_COMMAND "${llvm_libs}")
+  # the order of the clang libraries does matter for static linking.
+  list(APPEND libs
+    clangTooling
+    clangFrontend
+    clangDriver
+    clangSerialization
+    clangParse
+    clangSema
+    clangAnalysis
+    clangEdit
+    clangAST
+    clangLex
+    clangBasic)
+  list(APPEND libs ${llvm_libs})
+  # llvm-config lists the system libraries with the linker flags.
+  list(APPEND libs ${llvm_ldflags})
+
+  set(CLANG_LIBRARIES ${libs} PARENT_SCOPE)
+endfunction()
+
 
 find_program(LLVM_CONFIG
   NAMES llvm-config-3.2 llvm-config
@@ -81,8 +113,10 @@ endif()
 
 set_clang_definitions(${LLVM_CONFIG})
 set_clang_include_dirs(${LLVM_CONFIG})
+set_clang_libraries(${LLVM_CONFIG})
 
 message(STATUS "llvm-config filtered cpp flags : ${CLANG_DEFINITIONS}")
 message(STATUS "llvm-config filtered include dirs : ${CLANG_INCLUDE_DIRS}")
+message(STATUS "llvm-config libraries : ${CLANG_LIBRARIES}")
 
 set(CLANG_FOUND 1)
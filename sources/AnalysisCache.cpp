@@ -0,0 +1,505 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "AnalysisCache.hpp"
+
+#include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/FileManager.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace {
+
+// Increment it when the format or the meaning of the entries changes.
+char const * const FormatVersion = "constantine-cache-4";
+
+// FNV-1a, which is stable between runs and platforms.
+class Hash {
+public:
+    Hash()
+        : Value(14695981039346656037ULL)
+    { }
+
+    Hash & Add(llvm::StringRef const Data) {
+        for (llvm::StringRef::const_iterator It(Data.begin()), End(Data.end()); It != End; ++It) {
+            Value ^= static_cast<unsigned char>(*It);
+            Value *= 1099511628211ULL;
+        }
+        return *this;
+    }
+
+    Hash & Add(bool const Flag) {
+        return Add(llvm::StringRef(Flag ? "1" : "0"));
+    }
+
+    std::string AsString() const {
+        std::string Result;
+        llvm::raw_string_ostream Out(Result);
+        Out.write_hex(Value);
+        return Out.str();
+    }
+
+private:
+    unsigned long long Value;
+};
+
+// Only those options are hashed, which change the meaning of a header.
+std::string GetLanguageHash(clang::LangOptions const & Opts) {
+    return Hash()
+        .Add(llvm::StringRef(FormatVersion))
+        .Add(bool(Opts.CPlusPlus))
+        .Add(bool(Opts.CPlusPlus0x))
+        .Add(bool(Opts.GNUMode))
+        .Add(bool(Opts.MicrosoftExt))
+        .Add(bool(Opts.Exceptions))
+        .Add(bool(Opts.CXXExceptions))
+        .Add(bool(Opts.RTTI))
+        .Add(bool(Opts.CharIsSigned))
+        .AsString();
+}
+
+// Hash of the meaning of a function: the kind of the statements, the
+// operators, the literals and the referred declarations with their
+// canonical types. The AST is built from the preprocessed tokens, so the
+// macro bodies and the command line defines are part of it, and so are
+// the signatures of the callees and the types of the members.
+class MeaningHash
+    : public boost::noncopyable
+    , public clang::RecursiveASTVisitor<MeaningHash> {
+public:
+    MeaningHash(Hash & InResult)
+        : boost::noncopyable()
+        , clang::RecursiveASTVisitor<MeaningHash>()
+        , Result(InResult)
+    { }
+
+    bool VisitStmt(clang::Stmt const * const S) {
+        Add(S->getStmtClassName());
+        if (clang::Expr const * const E = clang::dyn_cast<clang::Expr const>(S)) {
+            Add(E->getType());
+        }
+        return true;
+    }
+    bool VisitDeclaratorDecl(clang::DeclaratorDecl const * const D) {
+        Add(D);
+        return true;
+    }
+    bool VisitDeclRefExpr(clang::DeclRefExpr const * const E) {
+        Add(E->getDecl());
+        return true;
+    }
+    bool VisitMemberExpr(clang::MemberExpr const * const E) {
+        Add(E->getMemberDecl());
+        return true;
+    }
+    bool VisitCXXConstructExpr(clang::CXXConstructExpr const * const E) {
+        Add(E->getConstructor());
+        return true;
+    }
+    bool VisitCastExpr(clang::CastExpr const * const E) {
+        Add(E->getCastKindName());
+        return true;
+    }
+    bool VisitBinaryOperator(clang::BinaryOperator const * const E) {
+        Add(clang::BinaryOperator::getOpcodeStr(E->getOpcode()));
+        return true;
+    }
+    bool VisitUnaryOperator(clang::UnaryOperator const * const E) {
+        Add(clang::UnaryOperator::getOpcodeStr(E->getOpcode()));
+        return true;
+    }
+    bool VisitIntegerLiteral(clang::IntegerLiteral const * const E) {
+        Add(E->getValue().toString(10, true));
+        return true;
+    }
+    bool VisitCharacterLiteral(clang::CharacterLiteral const * const E) {
+        std::string Value;
+        llvm::raw_string_ostream Out(Value);
+        Out << E->getValue();
+        Add(Out.str());
+        return true;
+    }
+    bool VisitFloatingLiteral(clang::FloatingLiteral const * const E) {
+        llvm::SmallString<32> Value;
+        E->getValue().toString(Value);
+        Add(Value.str());
+        return true;
+    }
+    bool VisitStringLiteral(clang::StringLiteral const * const E) {
+        Add(E->getBytes());
+        return true;
+    }
+    bool VisitCXXBoolLiteralExpr(clang::CXXBoolLiteralExpr const * const E) {
+        Result.Add(bool(E->getValue()));
+        return true;
+    }
+
+private:
+    void Add(llvm::StringRef const Data) {
+        // the separator keeps the fields apart.
+        Result.Add(Data).Add(llvm::StringRef("\n"));
+    }
+    void Add(clang::QualType const Type) {
+        Add(Type.getCanonicalType().getAsString());
+    }
+    void Add(clang::ValueDecl const * const D) {
+        if (D) {
+            Add(D->getQualifiedNameAsString());
+            Add(D->getType());
+        }
+    }
+
+private:
+    Hash & Result;
+};
+
+class Guard : public boost::noncopyable {
+public:
+    Guard(pthread_mutex_t & InLock)
+        : boost::noncopyable()
+        , Lock(InLock)
+    {
+        pthread_mutex_lock(&Lock);
+    }
+
+    ~Guard() {
+        pthread_mutex_unlock(&Lock);
+    }
+
+private:
+    pthread_mutex_t & Lock;
+};
+
+// Serializes the update of a cache file between the processes.
+class FileLock : public boost::noncopyable {
+public:
+    FileLock(std::string const & Path)
+        : boost::noncopyable()
+        , Descriptor(open(Path.c_str(), O_RDWR | O_CREAT, 0644))
+    {
+        if (-1 != Descriptor) {
+            flock(Descriptor, LOCK_EX);
+        }
+    }
+
+    ~FileLock() {
+        if (-1 != Descriptor) {
+            close(Descriptor);
+        }
+    }
+
+private:
+    int const Descriptor;
+};
+
+void Resolve(std::set<std::string> const & Keys,
+             clang::DeclaratorDecl const * const D,
+             std::string const & Key,
+             Variables & Out) {
+    if ((! Key.empty()) && Keys.count(Key)) {
+        Out.insert(D);
+    }
+}
+
+} // namespace anonymous
+
+
+AnalysisCache::AnalysisCache(std::string const & InDirectory, clang::ASTContext const & Ctx)
+    : boost::noncopyable()
+    , Directory(InDirectory)
+    , Sources(Ctx.getSourceManager())
+    , LanguageHash(GetLanguageHash(Ctx.getLangOpts()))
+    , Units()
+    , Hashes()
+{
+    pthread_mutex_init(&Lock, 0);
+
+    bool Existed = false;
+    llvm::sys::fs::create_directories(Directory, Existed);
+}
+
+AnalysisCache::~AnalysisCache() {
+    pthread_mutex_destroy(&Lock);
+}
+
+bool AnalysisCache::Lookup(clang::FunctionDecl const * const F, Queries const & Qs, ScopeSummary & Result) {
+    Guard const G(Lock);
+
+    Unit * const U = GetUnit(F);
+    if (! U) {
+        return false;
+    }
+    std::map<std::string, Entry>::const_iterator const It =
+        U->Functions.find(GetIdentity(GetKey(F), GetBodyHash(F), GetRecordHash(F)));
+    if (U->Functions.end() == It) {
+        return false;
+    }
+    Entry const & E = It->second;
+    for (Queries::const_iterator QIt(Qs.begin()), QEnd(Qs.end()); QIt != QEnd; ++QIt) {
+        std::string const Key = GetKey(*QIt);
+        Resolve(E.Changed, *QIt, Key, Result.Changed);
+        Resolve(E.Referenced, *QIt, Key, Result.Referenced);
+    }
+    Result.ThisReferenced = E.ThisReferenced;
+    return true;
+}
+
+void AnalysisCache::Store(clang::FunctionDecl const * const F, ScopeSummary const & Summary) {
+    Guard const G(Lock);
+
+    Unit * const U = GetUnit(F);
+    if (! U) {
+        return;
+    }
+    std::string const BodyHash = GetBodyHash(F);
+    if (BodyHash.empty()) {
+        return;
+    }
+    Entry E;
+    E.Function = GetKey(F);
+    E.BodyHash = BodyHash;
+    E.RecordHash = GetRecordHash(F);
+    for (Variables::const_iterator It(Summary.Changed.begin()), End(Summary.Changed.end()); It != End; ++It) {
+        E.Changed.insert(GetKey(*It));
+    }
+    for (Variables::const_iterator It(Summary.Referenced.begin()), End(Summary.Referenced.end()); It != End; ++It) {
+        E.Referenced.insert(GetKey(*It));
+    }
+    // declarations without location can not be restored.
+    E.Changed.erase(std::string());
+    E.Referenced.erase(std::string());
+    E.ThisReferenced = Summary.ThisReferenced;
+    U->Functions[GetIdentity(E.Function, E.BodyHash, E.RecordHash)] = E;
+    U->Dirty = true;
+}
+
+void AnalysisCache::Flush() {
+    Guard const G(Lock);
+
+    for (std::map<unsigned, Unit>::iterator It(Units.begin()), End(Units.end()); It != End; ++It) {
+        if (It->second.Dirty) {
+            Save(It->second);
+            It->second.Dirty = false;
+        }
+    }
+}
+
+// Locals and parameters are identified by their function, the others by
+// their qualified name. Overloaded functions are distinguished by type.
+std::string AnalysisCache::GetKey(clang::NamedDecl const * const D) {
+    std::string Result;
+    llvm::raw_string_ostream Out(Result);
+    if (clang::FunctionDecl const * const F =
+            clang::dyn_cast_or_null<clang::FunctionDecl const>(D->getParentFunctionOrMethod())) {
+        std::pair<clang::FileID, unsigned> const Function =
+            Sources.getDecomposedExpansionLoc(F->getLocation());
+        std::pair<clang::FileID, unsigned> const Local =
+            Sources.getDecomposedExpansionLoc(D->getLocation());
+        if (Function.first.isInvalid() || (Function.first != Local.first)) {
+            return std::string();
+        }
+        Out << GetKey(F)
+            << '@' << (int(Local.second) - int(Function.second))
+            << ':' << D->getNameAsString();
+    } else {
+        Out << D->getQualifiedNameAsString();
+        if (clang::FunctionDecl const * const F = clang::dyn_cast<clang::FunctionDecl const>(D)) {
+            Out << ' ' << F->getType().getAsString();
+        }
+    }
+    return Out.str();
+}
+
+std::string AnalysisCache::GetTextHash(clang::SourceRange const Range) {
+    std::pair<clang::FileID, unsigned> const Begin =
+        Sources.getDecomposedExpansionLoc(Range.getBegin());
+    std::pair<clang::FileID, unsigned> const End =
+        Sources.getDecomposedExpansionLoc(Range.getEnd());
+    if (Begin.first.isInvalid() || (Begin.first != End.first) || (Begin.second > End.second)) {
+        return std::string();
+    }
+    bool Invalid = false;
+    llvm::StringRef const Content = Sources.getBufferData(Begin.first, &Invalid);
+    if (Invalid) {
+        return std::string();
+    }
+    // the range ends with the first character of the last token, which
+    // is the closing brace of the body.
+    return Hash().Add(Content.substr(Begin.second, End.second - Begin.second + 1)).AsString();
+}
+
+// The text is hashed too, because the locals are identified by their
+// offset from the function.
+std::string AnalysisCache::GetBodyHash(clang::FunctionDecl const * const F) {
+    std::map<clang::Decl const *, std::string>::const_iterator const It =
+        Hashes.find(F);
+    if (Hashes.end() != It) {
+        return It->second;
+    }
+    std::string const Text = GetTextHash(F->getSourceRange());
+    std::string Result;
+    if (! Text.empty()) {
+        Hash Meaning;
+        Meaning.Add(llvm::StringRef(Text));
+        MeaningHash(Meaning).TraverseDecl(const_cast<clang::FunctionDecl *>(F));
+        Result = Meaning.AsString();
+    }
+    Hashes.insert(std::make_pair(F, Result));
+    return Result;
+}
+
+// The meaning of a method body depends on the members of its class.
+std::string AnalysisCache::GetRecordHash(clang::FunctionDecl const * const F) {
+    clang::CXXMethodDecl const * const M = clang::dyn_cast<clang::CXXMethodDecl const>(F);
+    return M ? GetRecordHash(M->getParent()) : std::string();
+}
+
+// The text of the class, the types of its members and its bases.
+std::string AnalysisCache::GetRecordHash(clang::CXXRecordDecl const * const R) {
+    std::map<clang::Decl const *, std::string>::const_iterator const It =
+        Hashes.find(R);
+    if (Hashes.end() != It) {
+        return It->second;
+    }
+    Hash Result;
+    Result.Add(llvm::StringRef(GetTextHash(R->getSourceRange())));
+    for (clang::DeclContext::decl_iterator DIt(R->decls_begin()), DEnd(R->decls_end()); DIt != DEnd; ++DIt) {
+        clang::ValueDecl const * const D = clang::dyn_cast<clang::ValueDecl const>(*DIt);
+        if (D && (! D->isImplicit())) {
+            Result.Add(llvm::StringRef(D->getNameAsString()))
+                .Add(llvm::StringRef(D->getType().getCanonicalType().getAsString()));
+        }
+    }
+    for (clang::CXXRecordDecl::base_class_const_iterator BIt(R->bases_begin()), BEnd(R->bases_end()); BIt != BEnd; ++BIt) {
+        clang::CXXRecordDecl const * const Base = BIt->getType()->getAsCXXRecordDecl();
+        Result.Add(llvm::StringRef((Base && Base->hasDefinition())
+            ? GetRecordHash(Base->getDefinition())
+            : BIt->getType().getCanonicalType().getAsString()));
+    }
+    std::string const Value = Result.AsString();
+    Hashes.insert(std::make_pair(R, Value));
+    return Value;
+}
+
+AnalysisCache::Unit * AnalysisCache::GetUnit(clang::FunctionDecl const * const F) {
+    clang::FileID const File =
+        Sources.getFileID(Sources.getExpansionLoc(F->getLocation()));
+    if (File.isInvalid()) {
+        return 0;
+    }
+    std::map<unsigned, Unit>::iterator const It =
+        Units.find(File.getHashValue());
+    if (Units.end() != It) {
+        return &(It->second);
+    }
+    clang::FileEntry const * const Source = Sources.getFileEntryForID(File);
+    if (! Source) {
+        return 0;
+    }
+    llvm::SmallString<256> Path(Source->getName());
+    llvm::sys::fs::make_absolute(Path);
+
+    Unit & Result = Units[File.getHashValue()];
+    Result.Path = Directory + "/" + Hash().Add(Path.str()).AsString() + "-" + LanguageHash + ".cache";
+    Load(Result.Path, Result.Functions);
+    return &Result;
+}
+
+// A function might have more entries, when the translation units see it
+// differently (because of a define), those are kept side by side.
+std::string AnalysisCache::GetIdentity(std::string const & Function,
+                                       std::string const & BodyHash,
+                                       std::string const & RecordHash) {
+    return Function + '\n' + BodyHash + '\n' + RecordHash;
+}
+
+// The entries are stored as lines. A function entry starts with the key of
+// the function, followed by the source hashes and the keys of the changed
+// and used declarations. The entries which are already in the map are
+// kept.
+void AnalysisCache::Load(std::string const & Path, std::map<std::string, Entry> & Out) {
+    llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+    if (llvm::MemoryBuffer::getFile(Path, Buffer)) {
+        return;
+    }
+    Entry Current;
+    llvm::StringRef Rest = Buffer->getBuffer();
+    while (! Rest.empty()) {
+        std::pair<llvm::StringRef, llvm::StringRef> const Line = Rest.split('\n');
+        Rest = Line.second;
+
+        std::pair<llvm::StringRef, llvm::StringRef> const Field = Line.first.split(' ');
+        if ("function" == Field.first) {
+            Insert(Current, Out);
+            Current = Entry();
+            Current.Function = Field.second.str();
+        } else if ("body" == Field.first) {
+            Current.BodyHash = Field.second.str();
+        } else if ("record" == Field.first) {
+            Current.RecordHash = Field.second.str();
+        } else if ("changed" == Field.first) {
+            Current.Changed.insert(Field.second.str());
+        } else if ("referenced" == Field.first) {
+            Current.Referenced.insert(Field.second.str());
+        } else if ("this" == Field.first) {
+            Current.ThisReferenced = true;
+        }
+    }
+    Insert(Current, Out);
+}
+
+void AnalysisCache::Insert(Entry const & E, std::map<std::string, Entry> & Out) {
+    if (! (E.Function.empty() || E.BodyHash.empty())) {
+        Out.insert(std::make_pair(GetIdentity(E.Function, E.BodyHash, E.RecordHash), E));
+    }
+}
+
+// Other processes might update the same cache file meanwhile. So the file
+// is locked, the entries of it are merged with the ones of this process,
+// and written into a temporary file first, which is renamed at once.
+void AnalysisCache::Save(Unit const & U) {
+    FileLock const L(U.Path + ".lock");
+
+    std::map<std::string, Entry> Merged(U.Functions);
+    Load(U.Path, Merged);
+
+    std::string Temporary;
+    {
+        llvm::raw_string_ostream Out(Temporary);
+        Out << U.Path << ".tmp." << getpid();
+    }
+    {
+        std::string Error;
+        llvm::raw_fd_ostream Out(Temporary.c_str(), Error);
+        if (! Error.empty()) {
+            return;
+        }
+        for (std::map<std::string, Entry>::const_iterator It(Merged.begin()), End(Merged.end()); It != End; ++It) {
+            Entry const & E = It->second;
+            Out << "function " << E.Function << '\n';
+            Out << "body " << E.BodyHash << '\n';
+            Out << "record " << E.RecordHash << '\n';
+            for (std::set<std::string>::const_iterator KIt(E.Changed.begin()), KEnd(E.Changed.end()); KIt != KEnd; ++KIt) {
+                Out << "changed " << *KIt << '\n';
+            }
+            for (std::set<std::string>::const_iterator KIt(E.Referenced.begin()), KEnd(E.Referenced.end()); KIt != KEnd; ++KIt) {
+                Out << "referenced " << *KIt << '\n';
+            }
+            if (E.ThisReferenced) {
+                Out << "this\n";
+            }
+        }
+    }
+    if (llvm::sys::fs::rename(Temporary, U.Path)) {
+        bool Existed = false;
+        llvm::sys::fs::remove(Temporary, Existed);
+    }
+}
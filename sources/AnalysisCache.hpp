@@ -0,0 +1,110 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _AnalysisCache_hpp_
+#define _AnalysisCache_hpp_
+
+#include "ScopeAnalysis.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <pthread.h>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/SourceManager.h>
+
+#include <llvm/ADT/SmallVector.h>
+
+#include <boost/noncopyable.hpp>
+
+// Persistent cache of the scope analysis of functions. A function is
+// analysed again only when its body, or its class was changed. So a
+// header which is included by many translation units is analysed only by
+// the first one, and a re-run after an edit analyses only the edited
+// functions.
+//
+// The results are stored per source file in the cache directory. The name
+// of the file is made from the hash of the absolute path and the hash of
+// the language options, it only groups the entries, which are validated
+// by their content. An entry is keyed by the source text and the meaning
+// of the body: the preprocessed statements with the canonical types of
+// the referred declarations, so a change of a callee signature, a member
+// type, a macro body or a define invalidates it too. The key of a method
+// contains the members and the bases of its class. Declarations are
+// identified by their qualified name (and type for functions). Locals and
+// parameters are identified by their function and their offset from the
+// function.
+//
+// The analysis threads of a translation unit share the cache, the calls
+// are serialized.
+class AnalysisCache : public boost::noncopyable {
+public:
+    typedef llvm::SmallVectorImpl<clang::DeclaratorDecl const *> Queries;
+
+    AnalysisCache(std::string const & Directory, clang::ASTContext const &);
+    ~AnalysisCache();
+
+    // Restore the summary of the function, if it was stored and the source
+    // was not changed since. Only the queried declarations will be part of
+    // the result.
+    bool Lookup(clang::FunctionDecl const *, Queries const &, ScopeSummary &);
+    void Store(clang::FunctionDecl const *, ScopeSummary const &);
+
+    // Write out the files which got new results.
+    void Flush();
+
+private:
+    struct Entry {
+        Entry()
+            : Function()
+            , BodyHash()
+            , RecordHash()
+            , Changed()
+            , Referenced()
+            , ThisReferenced(false)
+        { }
+
+        std::string Function;
+        std::string BodyHash;
+        std::string RecordHash;
+        std::set<std::string> Changed;
+        std::set<std::string> Referenced;
+        bool ThisReferenced;
+    };
+    struct Unit {
+        Unit()
+            : Path()
+            , Functions()
+            , Dirty(false)
+        { }
+
+        std::string Path;
+        // keyed by the function and its hashes.
+        std::map<std::string, Entry> Functions;
+        bool Dirty;
+    };
+
+    std::string GetKey(clang::NamedDecl const *);
+    std::string GetTextHash(clang::SourceRange);
+    std::string GetBodyHash(clang::FunctionDecl const *);
+    std::string GetRecordHash(clang::FunctionDecl const *);
+    std::string GetRecordHash(clang::CXXRecordDecl const *);
+    Unit * GetUnit(clang::FunctionDecl const *);
+
+    static std::string GetIdentity(std::string const &, std::string const &, std::string const &);
+    static void Load(std::string const &, std::map<std::string, Entry> &);
+    static void Insert(Entry const &, std::map<std::string, Entry> &);
+    static void Save(Unit const &);
+
+private:
+    std::string const Directory;
+    clang::SourceManager const & Sources;
+    std::string const LanguageHash;
+    std::map<unsigned, Unit> Units;
+    // hashes of the bodies and the classes of this translation unit.
+    std::map<clang::Decl const *, std::string> Hashes;
+    pthread_mutex_t Lock;
+};
+
+#endif // _AnalysisCache_hpp_
@@ -1,10 +1,18 @@
 // This file is distributed under MIT-LICENSE. See COPYING for details.
 
+#define DEBUG_TYPE "constantine"
+
 #include "DeclarationCollector.hpp"
+#include "Statistics.hpp"
+
+#include <new>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
 
-#include <boost/bind.hpp>
-#include <boost/range.hpp>
-#include <boost/range/algorithm/transform.hpp>
+STATISTIC(NumRecords, "Number of records collected");
+STATISTIC(NumBases, "Number of base classes visited");
+STATISTIC(NumReferenceWalks, "Number of reference initializers collected");
 
 namespace {
 
@@ -16,13 +24,6 @@ void GetVariablesFromRecord(clang::CXXRecordDecl const & Rec, Variables & Out) {
     }
 }
 
-// sytax given by clang api
-bool GetVariablesFromRecord(clang::CXXRecordDecl const * const Rec, void * State) {
-    Variables & Out = *((Variables*)State);
-    GetVariablesFromRecord(*Rec, Out);
-    return true;
-}
-
 void GetMethodsFromRecord(clang::CXXRecordDecl const & Rec, Methods & Out) {
     for (clang::CXXRecordDecl::method_iterator It(Rec.method_begin()), End(Rec.method_end()); It != End; ++It) {
         if (clang::CXXMethodDecl const * const D = clang::dyn_cast<clang::CXXMethodDecl const>(*It)) {
@@ -31,34 +32,22 @@ void GetMethodsFromRecord(clang::CXXRecordDecl const & Rec, Methods & Out) {
     }
 }
 
-// sytax given by clang api
-bool GetMethodsFromRecord(clang::CXXRecordDecl const * const Rec, void * State) {
-    Methods & Out = *((Methods*)State);
-    GetMethodsFromRecord(*Rec, Out);
-    return true;
+// Get the definition of a base class, if it is known already.
+// (Dependent bases of a template has no definition.)
+clang::CXXRecordDecl const * GetBaseDefinition(clang::CXXBaseSpecifier const & Base) {
+    if (clang::RecordType const * const Ty = Base.getType()->getAs<clang::RecordType>()) {
+        if (clang::RecordDecl const * const D = Ty->getDecl()->getDefinition()) {
+            return clang::dyn_cast<clang::CXXRecordDecl const>(D);
+        }
+    }
+    return 0;
 }
 
 // Strip away parentheses and casts we don't care about.
 clang::Expr const * StripExpr(clang::Expr const * E) {
     while (E) {
-        if (clang::ParenExpr const * const Paren = clang::dyn_cast<clang::ParenExpr const>(E)) {
-            E = Paren->getSubExpr();
-            continue;
-        }
-        if (clang::CastExpr const * const CE = clang::dyn_cast<clang::CastExpr const>(E)) {
-            E = CE->getSubExpr();
-            continue;
-        }
-        if (clang::UnaryOperator const * const UnOp = clang::dyn_cast<clang::UnaryOperator const>(E)) {
-            E = UnOp->getSubExpr();
-            continue;
-        }
-        if (clang::MaterializeTemporaryExpr const * const M = clang::dyn_cast<clang::MaterializeTemporaryExpr const>(E)) {
-            E = M->GetTemporaryExpr();
-            continue;
-        }
-        if (clang::ArraySubscriptExpr const * const ASE = clang::dyn_cast<clang::ArraySubscriptExpr const>(E)) {
-            E = ASE->getBase();
+        if (clang::Expr const * const Child = StripOnce(E)) {
+            E = Child;
             continue;
         }
         break;
@@ -66,15 +55,16 @@ clang::Expr const * StripExpr(clang::Expr const * E) {
     return E;
 }
 
-std::set<clang::Expr const *> CollectRefereeExpr(clang::Expr const * const E) {
-    std::set<clang::Expr const *> Result;
+typedef llvm::SmallPtrSet<clang::Expr const *, 4> Expressions;
+
+Expressions CollectRefereeExpr(clang::Expr const * const E) {
+    Expressions Result;
 
-    std::set<clang::Expr const *> Works;
-    Works.insert(E);
+    llvm::SmallVector<clang::Expr const *, 4> Works;
+    Works.push_back(E);
 
     while (! Works.empty()) {
-        clang::Expr const * const Current = *(Works.begin());
-        Works.erase(Works.begin());
+        clang::Expr const * const Current = Works.pop_back_val();
 
         if (clang::Expr const * const Stripped = StripExpr(Current)) {
             if (clang::dyn_cast<clang::DeclRefExpr const>(Stripped)) {
@@ -91,8 +81,8 @@ std::set<clang::Expr const *> CollectRefereeExpr(clang::Expr const * const E) {
                 }
                 Result.insert(ME);
             } else if (clang::AbstractConditionalOperator const * const ACO = clang::dyn_cast<clang::AbstractConditionalOperator const>(Stripped)) {
-                Works.insert(ACO->getTrueExpr());
-                Works.insert(ACO->getFalseExpr());
+                Works.push_back(ACO->getTrueExpr());
+                Works.push_back(ACO->getFalseExpr());
             }
         }
     }
@@ -114,10 +104,50 @@ clang::DeclaratorDecl const * GetDeclarationFromExpr(clang::Expr const * const E
     return 0;
 }
 
+// Only the reference and pointer variables refer to other declarations.
+clang::VarDecl const * GetAlias(clang::DeclaratorDecl const * const D) {
+    if (! D) {
+        return 0;
+    }
+    clang::QualType const & T = D->getType();
+    if (! ((*T).isReferenceType() || (*T).isPointerType())) {
+        return 0;
+    }
+    return clang::dyn_cast<clang::VarDecl const>(D);
+}
+
 } // namespace anonymous
 
 
+clang::Expr const * StripOnce(clang::Expr const * const E) {
+    if (clang::ParenExpr const * const Paren = clang::dyn_cast<clang::ParenExpr const>(E)) {
+        return Paren->getSubExpr();
+    }
+    if (clang::CastExpr const * const CE = clang::dyn_cast<clang::CastExpr const>(E)) {
+        return CE->getSubExpr();
+    }
+    if (clang::UnaryOperator const * const UnOp = clang::dyn_cast<clang::UnaryOperator const>(E)) {
+        return UnOp->getSubExpr();
+    }
+    if (clang::MaterializeTemporaryExpr const * const M = clang::dyn_cast<clang::MaterializeTemporaryExpr const>(E)) {
+        return M->GetTemporaryExpr();
+    }
+    if (clang::ArraySubscriptExpr const * const ASE = clang::dyn_cast<clang::ArraySubscriptExpr const>(E)) {
+        return ASE->getBase();
+    }
+    return 0;
+}
+
+clang::Expr const * GetObjectArgument(clang::CXXOperatorCallExpr const * const E) {
+    clang::FunctionDecl const * const F = E->getDirectCallee();
+    if (F && clang::dyn_cast<clang::CXXMethodDecl const>(F) && (0 < E->getNumArgs())) {
+        return E->getArg(0);
+    }
+    return 0;
+}
+
 Variables GetVariablesFromContext(clang::DeclContext const * const F, bool const WithoutArgs) {
+    PhaseTimer const Timer(DeclarationCollection);
     Variables Result;
     for (clang::DeclContext::decl_iterator It(F->decls_begin()), End(F->decls_end()); It != End; ++It ) {
         if (clang::VarDecl const * const D = clang::dyn_cast<clang::VarDecl const>(*It)) {
@@ -130,63 +160,201 @@ Variables GetVariablesFromContext(clang::DeclContext const * const F, bool const
 }
 
 Variables GetVariablesFromRecord(clang::CXXRecordDecl const * const Rec) {
-    Variables Result;
-    GetVariablesFromRecord(*Rec, Result);
-    Rec->forallBases(GetVariablesFromRecord, &Result);
-    return Result;
+    RecordCache Cache;
+    return Cache.GetVariables(Rec);
+}
+
+RecordCache::RecordCache()
+    : boost::noncopyable()
+    , Arena()
+    , Entries()
+    , EntryBytes(0)
+{ }
+
+Variables const & RecordCache::GetVariables(clang::CXXRecordDecl const * const Rec) {
+    return Get(Rec).MemberVariables;
 }
 
-Methods GetMethodsFromRecord(clang::CXXRecordDecl const * const Rec) {
+// The methods are collected at every query, because the implicit members
+// of a class (like the copy assignment) are declared at their first use,
+// which might be after the first method of the class was analysed.
+Methods RecordCache::GetMethods(clang::CXXRecordDecl const * const Rec) const {
+    PhaseTimer const Timer(DeclarationCollection);
     Methods Result;
-    GetMethodsFromRecord(*Rec, Result);
-    Rec->forallBases(GetMethodsFromRecord, &Result);
+    llvm::SmallPtrSet<clang::CXXRecordDecl const *, 8> Visited;
+    llvm::SmallVector<clang::CXXRecordDecl const *, 8> Works;
+    Works.push_back(Rec->hasDefinition() ? Rec->getDefinition() : Rec);
+    while (! Works.empty()) {
+        clang::CXXRecordDecl const * const Current = Works.pop_back_val();
+        if (! Visited.insert(Current)) {
+            continue;
+        }
+        GetMethodsFromRecord(*Current, Result);
+        if (! Current->hasDefinition()) {
+            continue;
+        }
+        for (clang::CXXRecordDecl::base_class_const_iterator It(Current->bases_begin()), End(Current->bases_end()); It != End; ++It) {
+            if (clang::CXXRecordDecl const * const Base = GetBaseDefinition(*It)) {
+                Works.push_back(Base);
+            }
+        }
+    }
     return Result;
 }
 
-Variables GetReferedVariables(clang::DeclaratorDecl const * const D) {
-    Variables Result;
+std::size_t RecordCache::GetMemorySize() const {
+    return EntryBytes + Entries.getMemorySize();
+}
+
+RecordCache::Entry const & RecordCache::Get(clang::CXXRecordDecl const * const Rec) {
+    PhaseTimer const Timer(DeclarationCollection);
+    clang::CXXRecordDecl const * const Key = Rec->getCanonicalDecl();
+    {
+        llvm::DenseMap<clang::CXXRecordDecl const *, Entry *>::const_iterator const It = Entries.find(Key);
+        if (Entries.end() != It) {
+            return *(It->second);
+        }
+    }
+    // the entry is registered before the bases are visited.
+    Entry & Result = *(new (Arena.Allocate()) Entry());
+    Entries[Key] = &Result;
+    ++NumRecords;
+
+    clang::CXXRecordDecl const * const Def =
+        Rec->hasDefinition() ? Rec->getDefinition() : Rec;
+    GetVariablesFromRecord(*Def, Result.MemberVariables);
+    if (! Rec->hasDefinition()) {
+        EntryBytes += ::GetMemorySize(Result.MemberVariables);
+        return Result;
+    }
+    // the direct bases are cached with their own bases, so shared bases
+    // are collected only at the first time.
+    for (clang::CXXRecordDecl::base_class_const_iterator It(Def->bases_begin()), End(Def->bases_end()); It != End; ++It) {
+        if (clang::CXXRecordDecl const * const Base = GetBaseDefinition(*It)) {
+            ++NumBases;
+            Entry const & Inherited = Get(Base);
+            Result.MemberVariables.insert(Inherited.MemberVariables.begin(), Inherited.MemberVariables.end());
+        }
+    }
+    EntryBytes += ::GetMemorySize(Result.MemberVariables);
+    return Result;
+}
 
-    Variables Works;
-    Works.insert(D);
+AliasGraph::AliasGraph()
+    : boost::noncopyable()
+    , Edges()
+    , Referees()
+{ }
 
+void AliasGraph::GetReferedVariables(clang::DeclaratorDecl const * const D, Variables & Out) {
+    PhaseTimer const Timer(ReferenceTracking);
+    llvm::SmallVector<clang::DeclaratorDecl const *, 16> Works;
+    if (D) {
+        Works.push_back(D);
+    }
     while (! Works.empty()) {
-        // get the current element
-        clang::DeclaratorDecl const * const Current = *(Works.begin());
-        Works.erase(Works.begin());
-        // current element goes into results
-        if (Current) {
-            Result.insert(Current);
-        } else {
+        clang::DeclaratorDecl const * const Current = Works.pop_back_val();
+        if (! Out.insert(Current)) {
             continue;
         }
-        // check is it reference or pointer type
-        {
-            clang::QualType const & T = Current->getType();
-            if (! ((*T).isReferenceType() || (*T).isPointerType())) {
+        if (clang::VarDecl const * const V = GetAlias(Current)) {
+            Range const Rs = GetReferees(V);
+            Works.append(Edges.begin() + Rs.first, Edges.begin() + Rs.second);
+        }
+    }
+}
+
+// The member variables are not copied, only the referring locals (and
+// the locals on the way to the members) are collected. The aliases which
+// reach a member are found backwards from the members, then the ones of
+// them which are locals are walked forward. Both walks visit a node once.
+void AliasGraph::GetMemberReferences(Variables const & Members, clang::DeclContext const * const F, Variables & Out) {
+    PhaseTimer const Timer(DeclarationCollection);
+    Variables const & Locals = GetVariablesFromContext(F);
+    // the reversed edges of the aliases, which are reachable from the locals.
+    llvm::DenseMap<clang::DeclaratorDecl const *, llvm::SmallVector<clang::VarDecl const *, 2> > Referers;
+    {
+        Variables Visited;
+        llvm::SmallVector<clang::VarDecl const *, 16> Works;
+        for (Variables::const_iterator It(Locals.begin()), End(Locals.end()); It != End; ++It) {
+            if (clang::VarDecl const * const V = GetAlias(*It)) {
+                Works.push_back(V);
+            }
+        }
+        while (! Works.empty()) {
+            clang::VarDecl const * const Current = Works.pop_back_val();
+            if (! Visited.insert(Current)) {
                 continue;
             }
+            Range const Rs = GetReferees(Current);
+            for (unsigned It = Rs.first; It != Rs.second; ++It) {
+                clang::DeclaratorDecl const * const Referee = Edges[It];
+                Referers[Referee].push_back(Current);
+                if (clang::VarDecl const * const V = GetAlias(Referee)) {
+                    Works.push_back(V);
+                }
+            }
         }
-        // check is it refer to a variable
-        if (clang::VarDecl const * const V = clang::dyn_cast<clang::VarDecl const>(Current)) {
-            // get the initialization expression
-            std::set<clang::Expr const *> const & Es = CollectRefereeExpr(V->getInit());
-            boost::transform(Es, std::inserter(Works, Works.begin()), &GetDeclarationFromExpr);
+    }
+    if (Referers.empty()) {
+        return;
+    }
+    Variables Reaching;
+    {
+        llvm::SmallVector<clang::DeclaratorDecl const *, 16> Works(Members.begin(), Members.end());
+        while (! Works.empty()) {
+            llvm::DenseMap<clang::DeclaratorDecl const *, llvm::SmallVector<clang::VarDecl const *, 2> >::const_iterator const It =
+                Referers.find(Works.pop_back_val());
+            if (Referers.end() == It) {
+                continue;
+            }
+            for (llvm::SmallVector<clang::VarDecl const *, 2>::const_iterator RIt(It->second.begin()), REnd(It->second.end()); RIt != REnd; ++RIt) {
+                if (Reaching.insert(*RIt)) {
+                    Works.push_back(*RIt);
+                }
+            }
+        }
+    }
+    Variables Referred;
+    for (Variables::const_iterator It(Locals.begin()), End(Locals.end()); It != End; ++It) {
+        if (Reaching.count(*It)) {
+            GetReferedVariables(*It, Referred);
+        }
+    }
+    for (Variables::const_iterator It(Referred.begin()), End(Referred.end()); It != End; ++It) {
+        if (! Members.count(*It)) {
+            Out.insert(*It);
         }
     }
-    return Result;
 }
 
-Variables GetMemberVariablesAndReferences(clang::CXXRecordDecl const * const Rec, clang::DeclContext const * const F) {
-    Variables Members = GetVariablesFromRecord(Rec);
-    Variables const & Locals = GetVariablesFromContext(F);
-    for (Variables::const_iterator LoIt(Locals.begin()), LoEnd(Locals.end()); LoIt != LoEnd; ++LoIt) {
-        Variables const & Refs = GetReferedVariables(*LoIt);
-        for (Variables::const_iterator ReIt(Refs.begin()), ReEnd(Refs.end()); ReIt != ReEnd; ++ReIt) {
-            if (Members.count(*ReIt)) {
-                Members.insert(Refs.begin(), Refs.end());
-                break;
-            }
+void AliasGraph::Clear() {
+    Edges.clear();
+    Referees.clear();
+}
+
+std::size_t AliasGraph::GetMemorySize() const {
+    return Edges.capacity() * sizeof(clang::DeclaratorDecl const *) + Referees.getMemorySize();
+}
+
+// The direct referees of the initializer, which are added once per
+// declaration.
+AliasGraph::Range AliasGraph::GetReferees(clang::VarDecl const * const V) {
+    {
+        llvm::DenseMap<clang::VarDecl const *, Range>::const_iterator const It = Referees.find(V);
+        if (Referees.end() != It) {
+            return It->second;
         }
     }
-    return Members;
+    ++NumReferenceWalks;
+    unsigned const Begin = Edges.size();
+    Expressions const & Es = CollectRefereeExpr(V->getInit());
+    for (Expressions::const_iterator It(Es.begin()), End(Es.end()); It != End; ++It) {
+        if (clang::DeclaratorDecl const * const D = GetDeclarationFromExpr(*It)) {
+            Edges.push_back(D);
+        }
+    }
+    Range const Result(Begin, Edges.size());
+    Referees[V] = Result;
+    return Result;
 }
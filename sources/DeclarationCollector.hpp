@@ -3,12 +3,30 @@
 #ifndef _DeclarationCollector_hpp_
 #define _DeclarationCollector_hpp_
 
-#include <set>
+#include <cstddef>
+#include <utility>
+#include <vector>
 
 #include <clang/AST/AST.h>
 
-typedef std::set<clang::DeclaratorDecl const *> Variables;
-typedef std::set<clang::CXXMethodDecl const *> Methods;
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <boost/noncopyable.hpp>
+
+typedef llvm::SmallPtrSet<clang::DeclaratorDecl const *, 16> Variables;
+typedef llvm::SmallPtrSet<clang::CXXMethodDecl const *, 16> Methods;
+
+// The estimated size of a pointer set. Above the small size the elements
+// are on the heap, where the set keeps its load below 3/4.
+template <typename T, unsigned N>
+std::size_t GetMemorySize(llvm::SmallPtrSet<T, N> const & Set) {
+    return sizeof(Set) + ((N < Set.size())
+        ? (llvm::NextPowerOf2(Set.size() * 4 / 3) * sizeof(void *))
+        : 0);
+}
 
 // method to copy variables out from declaration context
 Variables GetVariablesFromContext(clang::DeclContext const * const F, bool const WithoutArgs = false);
@@ -16,14 +34,80 @@ Variables GetVariablesFromContext(clang::DeclContext const * const F, bool const
 // method to copy variables out from class declaration
 Variables GetVariablesFromRecord(clang::CXXRecordDecl const * const Rec);
 
-// method to copy methods out from class declaration 
-Methods GetMethodsFromRecord(clang::CXXRecordDecl const * const Rec);
+// Memoize the variables of class declarations (with the inherited ones).
+// Base classes which are inherited on multiple paths (diamond or virtual
+// inheritance) are collected only once. The methods are not memoized,
+// the implicit ones are declared later.
+class RecordCache : public boost::noncopyable {
+public:
+    RecordCache();
+
+    Variables const & GetVariables(clang::CXXRecordDecl const * const Rec);
+    Methods GetMethods(clang::CXXRecordDecl const * const Rec) const;
+
+    // The estimated size of the collected entries.
+    std::size_t GetMemorySize() const;
+
+private:
+    struct Entry {
+        Variables MemberVariables;
+    };
+
+    Entry const & Get(clang::CXXRecordDecl const * const Rec);
+
+private:
+    // the entries are allocated from an arena, because the map does
+    // not keep them on their place while it grows.
+    llvm::SpecificBumpPtrAllocator<Entry> Arena;
+    llvm::DenseMap<clang::CXXRecordDecl const *, Entry *> Entries;
+    std::size_t EntryBytes;
+};
+
+
+// method to step over a parenthesis, cast, unary operator, materialized
+// temporary or array subscript, which are not changing the referred
+// variable. It returns null, when the expression is none of these.
+clang::Expr const * StripOnce(clang::Expr const * const E);
+
+// method to get the object of a member operator call, which the result is
+// derived from. It returns null, when the operator is a free function.
+clang::Expr const * GetObjectArgument(clang::CXXOperatorCallExpr const * const E);
+
+// The references and pointers, and the declarations they were initialized
+// from. The aliasing goes one way: a change through a reference changes
+// its referees, but a change of the referee leaves the reference alone.
+// (Union of the both sides would report changes which never happen.)
+//
+// The direct referees of a declaration are collected at the first query.
+// Only the edges are stored, the queries walk those without recursion, so
+// a long chain of references costs linear time and memory. The graph is
+// kept only for the analysed function.
+class AliasGraph : public boost::noncopyable {
+public:
+    AliasGraph();
+
+    // method to add the declaration and the ones it refers to (the ones
+    // which are in the output already are not walked again)
+    void GetReferedVariables(clang::DeclaratorDecl const *, Variables & Out);
+
+    // method to add the locals of the function which refer to the members
+    void GetMemberReferences(Variables const & Members, clang::DeclContext const * const F, Variables & Out);
+
+    // method to drop the graph, when the function was analysed
+    void Clear();
+
+    // The estimated size of the collected edges.
+    std::size_t GetMemorySize() const;
 
+private:
+    // the referees of a declaration are a range of the edges.
+    typedef std::pair<unsigned, unsigned> Range;
 
-// method to get refered declarations from the given declaration
-Variables GetReferedVariables(clang::DeclaratorDecl const *);
+    Range GetReferees(clang::VarDecl const * const V);
 
-// method to get all member variables and all refered declarations
-Variables GetMemberVariablesAndReferences(clang::CXXRecordDecl const * const Rec, clang::DeclContext const * const F);
+private:
+    std::vector<clang::DeclaratorDecl const *> Edges;
+    llvm::DenseMap<clang::VarDecl const *, Range> Referees;
+};
 
 #endif // _DeclarationCollector_hpp_
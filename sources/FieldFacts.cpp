@@ -0,0 +1,129 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "FieldFacts.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace {
+
+char const * const KindNames[] = { "candidate", "changed" };
+
+// The fields are separated by tabs, which are not in names or paths.
+std::string FormatFact(FieldFact const & F) {
+    std::string Result;
+    llvm::raw_string_ostream Out(Result);
+    Out << KindNames[F.What] << '\t'
+        << F.Key << '\t'
+        << F.Name << '\t'
+        << F.File << '\t'
+        << F.Line << '\t'
+        << F.Column << '\n';
+    return Out.str();
+}
+
+bool WriteAll(int const File, std::string const & Line) {
+    char const * Data = Line.data();
+    size_t Size = Line.size();
+    while (0 < Size) {
+        ssize_t const Written = write(File, Data, Size);
+        if (Written < 0) {
+            if (EINTR == errno)
+                continue;
+            return false;
+        }
+        Data += Written;
+        Size -= Written;
+    }
+    return true;
+}
+
+// The absolute path of the translation unit, with the separators (and the
+// escape character) escaped, so it is a file name.
+std::string GetFactsFile(std::string const & Directory, std::string const & Unit) {
+    llvm::SmallString<256> Absolute(Unit);
+    llvm::sys::fs::make_absolute(Absolute);
+
+    std::string Result;
+    llvm::raw_string_ostream Out(Result);
+    Out << Directory << '/';
+    for (llvm::SmallString<256>::const_iterator It(Absolute.begin()), End(Absolute.end()); It != End; ++It) {
+        switch (*It) {
+        case '/' : Out << "%2F"; break;
+        case '%' : Out << "%25"; break;
+        default : Out << *It;
+        }
+    }
+    Out << ".facts";
+    return Out.str();
+}
+
+} // namespace anonymous
+
+
+// The facts are written into a temporary file first, which is renamed at
+// once. So the reader never sees a partial file.
+bool WriteFieldFacts(std::string const & Directory, std::string const & Unit, FieldFacts const & Facts, std::string & Error) {
+    bool Existed = false;
+    if (llvm::error_code const Code = llvm::sys::fs::create_directories(Directory, Existed)) {
+        Error = Code.message();
+        return false;
+    }
+    std::string const Path = GetFactsFile(Directory, Unit);
+    std::string Temporary;
+    {
+        llvm::raw_string_ostream Out(Temporary);
+        Out << Path << ".tmp." << getpid();
+    }
+    int const File = open(Temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (-1 == File) {
+        Error = std::strerror(errno);
+        return false;
+    }
+    bool Result = true;
+    for (FieldFacts::const_iterator It(Facts.begin()), End(Facts.end()); Result && (It != End); ++It) {
+        Result = WriteAll(File, FormatFact(*It));
+    }
+    if (! Result) {
+        Error = std::strerror(errno);
+    }
+    close(File);
+    if (Result) {
+        if (llvm::error_code const Code = llvm::sys::fs::rename(Temporary, Path)) {
+            Error = Code.message();
+            Result = false;
+        }
+    }
+    if (! Result) {
+        llvm::sys::fs::remove(Temporary, Existed);
+    }
+    return Result;
+}
+
+bool ParseFieldFact(llvm::StringRef const Line, FieldFact & Result) {
+    llvm::SmallVector<llvm::StringRef, 6> Fields;
+    Line.split(Fields, "\t");
+    if (6 != Fields.size()) {
+        return false;
+    }
+    if (KindNames[FieldFact::Candidate] == Fields[0]) {
+        Result.What = FieldFact::Candidate;
+    } else if (KindNames[FieldFact::Changed] == Fields[0]) {
+        Result.What = FieldFact::Changed;
+    } else {
+        return false;
+    }
+    Result.Key = Fields[1].str();
+    Result.Name = Fields[2].str();
+    Result.File = Fields[3].str();
+    return (! Fields[4].getAsInteger(10, Result.Line))
+        && (! Fields[5].getAsInteger(10, Result.Column));
+}
@@ -0,0 +1,45 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _FieldFacts_hpp_
+#define _FieldFacts_hpp_
+
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringRef.h>
+
+// What a translation unit knows about a member variable. A member variable
+// might be changed by a function in an other translation unit, so only the
+// facts of the whole program can decide its constness.
+//
+// The facts are lines in a text file. Every translation unit has its own
+// file in the facts directory (named after the path of its main file),
+// which is replaced when the translation unit is compiled again. So
+// parallel compilations can share the directory, and the facts of a
+// recompiled translation unit are not stale.
+struct FieldFact {
+    enum Kind
+        { Candidate
+        , Changed
+        };
+
+    Kind What;
+    // identifies the member variable. (qualified name, with the file name
+    // for the ones in anonymous namespaces)
+    std::string Key;
+    std::string Name;
+    std::string File;
+    unsigned Line;
+    unsigned Column;
+};
+
+typedef std::vector<FieldFact> FieldFacts;
+
+// Replaces the facts of the translation unit in the directory. Returns
+// false and sets the error message on failure.
+bool WriteFieldFacts(std::string const & Directory, std::string const & Unit, FieldFacts const &, std::string & Error);
+
+// Returns false when the line is not a valid fact.
+bool ParseFieldFact(llvm::StringRef Line, FieldFact &);
+
+#endif // _FieldFacts_hpp_
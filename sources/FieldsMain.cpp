@@ -0,0 +1,265 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "FieldFacts.hpp"
+#include "OutputFormat.hpp"
+#include "ReportWriter.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+
+namespace {
+
+llvm::cl::list<std::string>
+    Inputs(llvm::cl::Positional,
+        llvm::cl::desc("<facts directory or file> ..."),
+        llvm::cl::OneOrMore);
+llvm::cl::opt<OutputFormat>
+    Format("format",
+        llvm::cl::desc("The format of the findings:"),
+        llvm::cl::init(Diagnostics),
+        llvm::cl::values(
+            clEnumValN(Diagnostics, "text", "Print the findings as compiler diagnostics"),
+            clEnumValN(JsonLines, "jsonl", "Write JSON Lines"),
+            clEnumValN(Sarif, "sarif", "Write a SARIF log"),
+            clEnumValN(Binary, "binary", "Write a binary result file"),
+            clEnumValEnd));
+llvm::cl::opt<std::string>
+    Output("o",
+        llvm::cl::desc("The output file (standard output by default)"),
+        llvm::cl::init("/dev/stdout"));
+llvm::cl::opt<unsigned>
+    Jobs("j",
+        llvm::cl::desc("Number of threads to read the facts (number of processors by default)"),
+        llvm::cl::init(0));
+
+// The facts files are cut into pieces of this size (at line ends), so
+// a big file is read by multiple threads.
+size_t const ChunkSize = 1 << 20;
+
+// What the whole program knows about a member variable.
+struct Field {
+    Field()
+        : Candidate(false)
+        , Changed(false)
+        , Name()
+        , File()
+        , Line(0)
+        , Column(0)
+    { }
+
+    void Add(FieldFact const & Fact) {
+        if (FieldFact::Changed == Fact.What) {
+            Changed = true;
+            return;
+        }
+        if (! Candidate) {
+            Candidate = true;
+            Name = Fact.Name;
+            File = Fact.File;
+            Line = Fact.Line;
+            Column = Fact.Column;
+        }
+    }
+
+    void Merge(Field const & Other) {
+        Changed = Changed || Other.Changed;
+        if (Other.Candidate && (! Candidate)) {
+            Candidate = true;
+            Name = Other.Name;
+            File = Other.File;
+            Line = Other.Line;
+            Column = Other.Column;
+        }
+    }
+
+    bool Candidate;
+    bool Changed;
+    std::string Name;
+    std::string File;
+    unsigned Line;
+    unsigned Column;
+};
+
+typedef llvm::StringMap<Field> Fields;
+
+// The map step: every thread collects the facts of its chunks into its
+// own table. The reduce step merges the tables.
+class ReadFacts : public ThreadPool::Work {
+public:
+    ReadFacts(std::vector<llvm::StringRef> const & InChunks, unsigned const Threads)
+        : ThreadPool::Work()
+        , Chunks(InChunks)
+        , Tables(Threads)
+    { }
+
+    void Run(unsigned const Thread, unsigned const Task) {
+        Fields & Table = Tables[Thread];
+        FieldFact Fact;
+        llvm::StringRef Rest = Chunks[Task];
+        while (! Rest.empty()) {
+            std::pair<llvm::StringRef, llvm::StringRef> const Line = Rest.split('\n');
+            Rest = Line.second;
+            if (ParseFieldFact(Line.first, Fact)) {
+                Table[Fact.Key].Add(Fact);
+            }
+        }
+    }
+
+    void MergeInto(Fields & Result) const {
+        for (std::vector<Fields>::const_iterator It(Tables.begin()), End(Tables.end()); It != End; ++It) {
+            for (Fields::const_iterator FIt(It->begin()), FEnd(It->end()); FIt != FEnd; ++FIt) {
+                Result[FIt->getKey()].Merge(FIt->getValue());
+            }
+        }
+    }
+
+private:
+    std::vector<llvm::StringRef> const & Chunks;
+    std::vector<Fields> Tables;
+};
+
+void Cut(llvm::StringRef Content, std::vector<llvm::StringRef> & Chunks) {
+    while (! Content.empty()) {
+        size_t End = Content.find('\n', std::min(ChunkSize, Content.size()));
+        End = (llvm::StringRef::npos == End) ? Content.size() : (End + 1);
+        Chunks.push_back(Content.substr(0, End));
+        Content = Content.substr(End);
+    }
+}
+
+struct IsBefore {
+    bool operator()(ReportWriter::Finding const & Lhs, ReportWriter::Finding const & Rhs) const {
+        if (Lhs.File != Rhs.File)
+            return Lhs.File < Rhs.File;
+        if (Lhs.Line != Rhs.Line)
+            return Lhs.Line < Rhs.Line;
+        if (Lhs.Column != Rhs.Column)
+            return Lhs.Column < Rhs.Column;
+        return Lhs.Key < Rhs.Key;
+    }
+};
+
+// The facts directories are expanded to their facts files (one per
+// translation unit).
+bool GetFactsFiles(std::string const & Input, std::vector<std::string> & Out) {
+    bool Directory = false;
+    if (llvm::sys::fs::is_directory(Input, Directory) || (! Directory)) {
+        Out.push_back(Input);
+        return true;
+    }
+    std::vector<std::string> Files;
+    llvm::error_code Error;
+    for (llvm::sys::fs::directory_iterator It(Input, Error), End; (! Error) && (It != End); It.increment(Error)) {
+        if (llvm::StringRef(It->path()).endswith(".facts")) {
+            Files.push_back(It->path());
+        }
+    }
+    if (Error) {
+        llvm::errs() << "constantine-fields: " << Input << ": " << Error.message() << '\n';
+        return false;
+    }
+    std::sort(Files.begin(), Files.end());
+    Out.insert(Out.end(), Files.begin(), Files.end());
+    return true;
+}
+
+unsigned GetJobs() {
+    if (0 != Jobs) {
+        return Jobs;
+    }
+    long const Processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (0 < Processors) ? Processors : 1;
+}
+
+} // namespace anonymous
+
+
+// Decide the constness of member variables by the facts of all translation
+// units. A member variable is reported, when it was a candidate in any
+// translation unit and was not changed in any of them.
+int main(int argc, char const * argv[]) {
+    llvm::cl::ParseCommandLineOptions(argc, argv, "constantine-fields - whole program member variable analysis\n");
+
+    std::vector<std::string> Files;
+    for (std::vector<std::string>::const_iterator It(Inputs.begin()), End(Inputs.end()); It != End; ++It) {
+        if (! GetFactsFiles(*It, Files)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    boost::ptr_vector<llvm::MemoryBuffer> Buffers;
+    std::vector<llvm::StringRef> Chunks;
+    for (std::vector<std::string>::const_iterator It(Files.begin()), End(Files.end()); It != End; ++It) {
+        llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+        if (llvm::error_code const Error = llvm::MemoryBuffer::getFile(*It, Buffer)) {
+            llvm::errs() << "constantine-fields: " << *It << ": " << Error.message() << '\n';
+            return EXIT_FAILURE;
+        }
+        Cut(Buffer->getBuffer(), Chunks);
+        Buffers.push_back(Buffer.take());
+    }
+
+    Fields Table;
+    {
+        unsigned const Threads = std::max(1u, std::min<unsigned>(GetJobs(), Chunks.size()));
+        ReadFacts Work(Chunks, Threads);
+        ThreadPool::Run(Work, Threads, Chunks.size());
+        Work.MergeInto(Table);
+    }
+
+    std::vector<ReportWriter::Finding> Findings;
+    for (Fields::const_iterator It(Table.begin()), End(Table.end()); It != End; ++It) {
+        Field const & F = It->getValue();
+        if (F.Candidate && (! F.Changed)) {
+            ReportWriter::Finding Finding;
+            Finding.Rule = "variable-const";
+            Finding.Level = "warning";
+            Finding.Message = "variable '" + F.Name + "' could be declared as const";
+            Finding.Key = It->getKey().str();
+            Finding.Name = F.Name;
+            Finding.File = F.File;
+            Finding.Line = F.Line;
+            Finding.Column = F.Column;
+            Findings.push_back(Finding);
+        }
+    }
+    std::sort(Findings.begin(), Findings.end(), IsBefore());
+
+    std::string Error;
+    llvm::OwningPtr<llvm::raw_fd_ostream> Text;
+    ReportWriter::Ptr Writer;
+    if (Diagnostics == Format) {
+        Text.reset(new llvm::raw_fd_ostream(Output.c_str(), Error));
+    } else {
+        Writer = ReportWriter::Create(Format, Output, Error);
+    }
+    if (! Error.empty()) {
+        llvm::errs() << "constantine-fields: " << Output << ": " << Error << '\n';
+        return EXIT_FAILURE;
+    }
+    for (std::vector<ReportWriter::Finding>::const_iterator It(Findings.begin()), End(Findings.end()); It != End; ++It) {
+        if (Writer.get()) {
+            Writer->Write(*It);
+        } else {
+            *Text << It->File << ':' << It->Line << ':' << It->Column << ": "
+                  << It->Level << ": " << It->Message << '\n';
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "FunctionProfile.hpp"
+
+#include <algorithm>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Timer.h>
+
+namespace {
+
+double Now() {
+    return llvm::TimeRecord::getCurrentTime(true).getWallTime();
+}
+
+unsigned CountNodes(clang::Stmt const * const Body) {
+    unsigned Result = 0;
+
+    llvm::SmallVector<clang::Stmt const *, 32> Works;
+    Works.push_back(Body);
+    while (! Works.empty()) {
+        clang::Stmt const * const Current = Works.pop_back_val();
+        if (! Current) {
+            continue;
+        }
+        ++Result;
+        for (clang::Stmt::const_child_range It = Current->children(); It; ++It) {
+            Works.push_back(*It);
+        }
+    }
+    return Result;
+}
+
+} // namespace anonymous
+
+
+struct FunctionProfile::IsMoreExpensive {
+    bool operator()(Cost const & Lhs, Cost const & Rhs) const {
+        return Lhs.Seconds > Rhs.Seconds;
+    }
+};
+
+FunctionProfile::FunctionProfile(unsigned const InLimit)
+    : boost::noncopyable()
+    , Limit(InLimit)
+    , Costs()
+{ }
+
+FunctionProfile::Probe::Probe(FunctionProfile & InProfile, clang::FunctionDecl const * const F)
+    : boost::noncopyable()
+    , Profile(InProfile)
+    , Function(F)
+    , Start((0 < InProfile.Limit) ? Now() : 0.0)
+    , References(0)
+    , Members(0)
+{ }
+
+FunctionProfile::Probe::~Probe() {
+    if (0 == Profile.Limit) {
+        return;
+    }
+    Cost C;
+    C.Function = Function;
+    C.Seconds = Now() - Start;
+    C.Nodes = CountNodes(Function->getBody());
+    C.References = References;
+    C.Members = Members;
+    Profile.Add(C);
+}
+
+void FunctionProfile::Probe::SetReferences(unsigned const Count) {
+    References = Count;
+}
+
+void FunctionProfile::Probe::SetMembers(unsigned const Count) {
+    Members = Count;
+}
+
+void FunctionProfile::Merge(FunctionProfile const & Other) {
+    for (std::vector<Cost>::const_iterator It(Other.Costs.begin()), End(Other.Costs.end()); It != End; ++It) {
+        Add(*It);
+    }
+}
+
+void FunctionProfile::Print(clang::SourceManager const & Sources, llvm::raw_ostream & Out) const {
+    if (Costs.empty()) {
+        return;
+    }
+    std::vector<Cost> Sorted(Costs);
+    std::sort(Sorted.begin(), Sorted.end(), IsMoreExpensive());
+
+    Out << "constantine: the " << Sorted.size() << " most expensive functions\n";
+    for (std::vector<Cost>::const_iterator It(Sorted.begin()), End(Sorted.end()); It != End; ++It) {
+        clang::PresumedLoc const Loc = Sources.getPresumedLoc(It->Function->getLocation());
+        if (Loc.isValid()) {
+            Out << Loc.getFilename() << ':' << Loc.getLine() << ':' << Loc.getColumn() << ": ";
+        }
+        Out << '\'' << It->Function->getQualifiedNameAsString() << "' "
+            << llvm::format("%.3f", It->Seconds * 1000.0) << " ms, "
+            << It->Nodes << " nodes, "
+            << It->References << " references, "
+            << It->Members << " members\n";
+    }
+}
+
+void FunctionProfile::Add(Cost const & C) {
+    if (0 == Limit) {
+        return;
+    }
+    Costs.push_back(C);
+    std::push_heap(Costs.begin(), Costs.end(), IsMoreExpensive());
+    if (Limit < Costs.size()) {
+        std::pop_heap(Costs.begin(), Costs.end(), IsMoreExpensive());
+        Costs.pop_back();
+    }
+}
@@ -0,0 +1,65 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _FunctionProfile_hpp_
+#define _FunctionProfile_hpp_
+
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/SourceManager.h>
+
+#include <llvm/Support/raw_ostream.h>
+
+#include <boost/noncopyable.hpp>
+
+// Keeps the most expensive function analyses: the time they took, the
+// number of statements in the body, the number of referenced declarations
+// and the number of members of the class. Profiles of the threads of a
+// translation unit can be merged.
+class FunctionProfile : public boost::noncopyable {
+public:
+    // Nothing is measured with zero limit.
+    explicit FunctionProfile(unsigned Limit);
+
+    // Measures the analysis of a function while it's in scope.
+    class Probe : public boost::noncopyable {
+    public:
+        Probe(FunctionProfile &, clang::FunctionDecl const *);
+        ~Probe();
+
+        void SetReferences(unsigned);
+        void SetMembers(unsigned);
+
+    private:
+        FunctionProfile & Profile;
+        clang::FunctionDecl const * const Function;
+        double const Start;
+        unsigned References;
+        unsigned Members;
+    };
+
+    void Merge(FunctionProfile const &);
+
+    // Print the entries from the most expensive one.
+    void Print(clang::SourceManager const &, llvm::raw_ostream &) const;
+
+private:
+    struct Cost {
+        clang::FunctionDecl const * Function;
+        double Seconds;
+        unsigned Nodes;
+        unsigned References;
+        unsigned Members;
+    };
+
+    struct IsMoreExpensive;
+
+    void Add(Cost const &);
+
+private:
+    unsigned const Limit;
+    // a heap, which has the cheapest entry on the top.
+    std::vector<Cost> Costs;
+};
+
+#endif // _FunctionProfile_hpp_
@@ -0,0 +1,109 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "MemoryAccounting.hpp"
+
+#include <algorithm>
+
+namespace {
+
+char const * const StructureNames[MemoryAccounting::StructureCount] =
+    { "candidates and changes"
+    , "usage maps"
+    , "member sets"
+    , "arena"
+    };
+
+} // namespace anonymous
+
+
+struct MemoryAccounting::IsLarger {
+    bool operator()(Usage const & Lhs, Usage const & Rhs) const {
+        return Lhs.Bytes > Rhs.Bytes;
+    }
+};
+
+MemoryAccounting::MemoryAccounting(unsigned const InLimit)
+    : boost::noncopyable()
+    , Limit(InLimit)
+    , Functions()
+{
+    std::fill(Current, Current + StructureCount, 0);
+    std::fill(Peak, Peak + StructureCount, 0);
+}
+
+bool MemoryAccounting::IsEnabled() const {
+    return (0 < Limit);
+}
+
+void MemoryAccounting::Sample(Structure const S, std::size_t const Bytes) {
+    Current[S] = Bytes;
+    Peak[S] = std::max(Peak[S], Bytes);
+}
+
+MemoryAccounting::Probe::Probe(MemoryAccounting & InAccounting,
+                               clang::FunctionDecl const * const F,
+                               llvm::BumpPtrAllocator const & InArena)
+    : boost::noncopyable()
+    , Accounting(InAccounting)
+    , Function(F)
+    , Arena(InArena)
+    , ArenaBefore(InAccounting.IsEnabled() ? InArena.getTotalMemory() : 0)
+    , Bytes(0)
+{ }
+
+MemoryAccounting::Probe::~Probe() {
+    if (! Accounting.IsEnabled()) {
+        return;
+    }
+    std::size_t const ArenaAfter = Arena.getTotalMemory();
+    Accounting.Sample(ArenaBlocks, ArenaAfter);
+
+    Usage const U = { Function, Bytes + (ArenaAfter - ArenaBefore) };
+    Accounting.Add(U);
+}
+
+void MemoryAccounting::Probe::Add(std::size_t const InBytes) {
+    Bytes += InBytes;
+}
+
+void MemoryAccounting::Merge(MemoryAccounting const & Other) {
+    for (unsigned It = 0; It < StructureCount; ++It) {
+        Current[It] += Other.Current[It];
+        Peak[It] += Other.Peak[It];
+    }
+    for (std::vector<Usage>::const_iterator It(Other.Functions.begin()), End(Other.Functions.end()); It != End; ++It) {
+        Add(*It);
+    }
+}
+
+void MemoryAccounting::Print(clang::SourceManager const & Sources, llvm::raw_ostream & Out) const {
+    if (! IsEnabled()) {
+        return;
+    }
+    Out << "constantine: memory of the analysis\n";
+    for (unsigned It = 0; It < StructureCount; ++It) {
+        Out << "  " << StructureNames[It] << ": "
+            << Current[It] << " bytes (peak " << Peak[It] << " bytes)\n";
+    }
+    std::vector<Usage> Sorted(Functions);
+    std::sort(Sorted.begin(), Sorted.end(), IsLarger());
+
+    Out << "constantine: the " << Sorted.size() << " largest functions\n";
+    for (std::vector<Usage>::const_iterator It(Sorted.begin()), End(Sorted.end()); It != End; ++It) {
+        clang::PresumedLoc const Loc = Sources.getPresumedLoc(It->Function->getLocation());
+        if (Loc.isValid()) {
+            Out << Loc.getFilename() << ':' << Loc.getLine() << ':' << Loc.getColumn() << ": ";
+        }
+        Out << '\'' << It->Function->getQualifiedNameAsString() << "' "
+            << It->Bytes << " bytes\n";
+    }
+}
+
+void MemoryAccounting::Add(Usage const & U) {
+    Functions.push_back(U);
+    std::push_heap(Functions.begin(), Functions.end(), IsLarger());
+    if (Limit < Functions.size()) {
+        std::pop_heap(Functions.begin(), Functions.end(), IsLarger());
+        Functions.pop_back();
+    }
+}
@@ -0,0 +1,81 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _MemoryAccounting_hpp_
+#define _MemoryAccounting_hpp_
+
+#include <cstddef>
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/SourceManager.h>
+
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <boost/noncopyable.hpp>
+
+// Accounts the bytes which the data structures of the analysis hold: the
+// current and the peak size of each kind, and the functions which needed
+// the most memory to analyse. The sizes are estimated from the number of
+// elements and the growth policy of the containers.
+//
+// The accounting of the threads of a translation unit can be merged. The
+// sizes are added up then, so the peaks are upper bounds.
+class MemoryAccounting : public boost::noncopyable {
+public:
+    enum Structure
+        { AnalysisState
+        , UsageMaps
+        , MemberSets
+        , ArenaBlocks
+        , StructureCount
+        };
+
+    // Nothing is accounted with zero limit.
+    explicit MemoryAccounting(unsigned Limit);
+
+    bool IsEnabled() const;
+
+    // Register the current size of the given structure.
+    void Sample(Structure, std::size_t Bytes);
+
+    // Accounts the memory of a function analysis while it's in scope: the
+    // growth of the arena and the temporary structures which were added.
+    class Probe : public boost::noncopyable {
+    public:
+        Probe(MemoryAccounting &, clang::FunctionDecl const *, llvm::BumpPtrAllocator const &);
+        ~Probe();
+
+        void Add(std::size_t Bytes);
+
+    private:
+        MemoryAccounting & Accounting;
+        clang::FunctionDecl const * const Function;
+        llvm::BumpPtrAllocator const & Arena;
+        std::size_t const ArenaBefore;
+        std::size_t Bytes;
+    };
+
+    void Merge(MemoryAccounting const &);
+
+    void Print(clang::SourceManager const &, llvm::raw_ostream &) const;
+
+private:
+    struct Usage {
+        clang::FunctionDecl const * Function;
+        std::size_t Bytes;
+    };
+
+    struct IsLarger;
+
+    void Add(Usage const &);
+
+private:
+    unsigned const Limit;
+    std::size_t Current[StructureCount];
+    std::size_t Peak[StructureCount];
+    // a heap, which has the smallest entry on the top.
+    std::vector<Usage> Functions;
+};
+
+#endif // _MemoryAccounting_hpp_
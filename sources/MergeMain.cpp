@@ -0,0 +1,145 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "OutputFormat.hpp"
+#include "ReportWriter.hpp"
+#include "ResultFile.hpp"
+
+#include <cstdlib>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <boost/ptr_container/ptr_vector.hpp>
+
+
+namespace {
+
+llvm::cl::list<std::string>
+    Inputs(llvm::cl::Positional,
+        llvm::cl::desc("<result file> ..."),
+        llvm::cl::OneOrMore);
+llvm::cl::opt<OutputFormat>
+    Format("format",
+        llvm::cl::desc("The format of the merged findings:"),
+        llvm::cl::init(Diagnostics),
+        llvm::cl::values(
+            clEnumValN(Diagnostics, "text", "Print the findings as compiler diagnostics"),
+            clEnumValN(JsonLines, "jsonl", "Write JSON Lines"),
+            clEnumValN(Sarif, "sarif", "Write a SARIF log"),
+            clEnumValN(Binary, "binary", "Write a binary result file"),
+            clEnumValEnd));
+llvm::cl::opt<std::string>
+    Output("o",
+        llvm::cl::desc("The output file (standard output by default)"),
+        llvm::cl::init("/dev/stdout"));
+
+
+// The next not merged record of an input file.
+struct Cursor {
+    ResultFile const * File;
+    unsigned Index;
+
+    ResultRecord const & GetRecord() const {
+        return File->GetRecord(Index);
+    }
+};
+
+// The priority queue keeps the greatest on the top.
+struct IsAfter {
+    bool operator()(Cursor const & Lhs, Cursor const & Rhs) const {
+        return 0 < Compare(Lhs.File->GetStrings(), Lhs.GetRecord(),
+                           Rhs.File->GetStrings(), Rhs.GetRecord());
+    }
+};
+
+ReportWriter::Finding ToFinding(Cursor const & C) {
+    char const * const Strings = C.File->GetStrings();
+    ResultRecord const & R = C.GetRecord();
+
+    ReportWriter::Finding Result;
+    Result.Rule = Strings + R.Rule;
+    Result.Level = Strings + R.Level;
+    Result.Message = Strings + R.Message;
+    Result.Key = Strings + R.Key;
+    Result.Name = Strings + R.Name;
+    Result.File = Strings + R.File;
+    Result.Line = R.Line;
+    Result.Column = R.Column;
+    return Result;
+}
+
+void Print(llvm::raw_ostream & Out, ReportWriter::Finding const & F) {
+    Out << F.File << ':' << F.Line << ':' << F.Column << ": "
+        << F.Level << ": " << F.Message << '\n';
+}
+
+} // namespace anonymous
+
+
+// Merge the sorted result files with a k-way merge. Only the current record
+// of each file is compared, the files are mapped into memory. Findings which
+// were reported by multiple translation units (because those were in shared
+// headers) are written only once.
+int main(int argc, char const * argv[]) {
+    llvm::cl::ParseCommandLineOptions(argc, argv, "constantine-merge - merge result files\n");
+
+    boost::ptr_vector<ResultFile> Files;
+    for (std::vector<std::string>::const_iterator It(Inputs.begin()), End(Inputs.end()); It != End; ++It) {
+        std::string Error;
+        ResultFile * const File = ResultFile::Open(*It, Error);
+        if (! File) {
+            llvm::errs() << "constantine-merge: " << *It << ": " << Error << '\n';
+            return EXIT_FAILURE;
+        }
+        Files.push_back(File);
+    }
+
+    std::string Error;
+    llvm::OwningPtr<llvm::raw_fd_ostream> Text;
+    ReportWriter::Ptr Writer;
+    if (Diagnostics == Format) {
+        Text.reset(new llvm::raw_fd_ostream(Output.c_str(), Error));
+    } else {
+        Writer = ReportWriter::Create(Format, Output, Error);
+    }
+    if (! Error.empty()) {
+        llvm::errs() << "constantine-merge: " << Output << ": " << Error << '\n';
+        return EXIT_FAILURE;
+    }
+
+    std::priority_queue<Cursor, std::vector<Cursor>, IsAfter> Queue;
+    for (boost::ptr_vector<ResultFile>::const_iterator It(Files.begin()), End(Files.end()); It != End; ++It) {
+        if (0 < It->GetSize()) {
+            Cursor const C = { &(*It), 0 };
+            Queue.push(C);
+        }
+    }
+    bool HasLast = false;
+    Cursor Last = { 0, 0 };
+    while (! Queue.empty()) {
+        Cursor Current = Queue.top();
+        Queue.pop();
+
+        bool const IsDuplicate = HasLast &&
+            (0 == Compare(Last.File->GetStrings(), Last.GetRecord(),
+                          Current.File->GetStrings(), Current.GetRecord()));
+        if (! IsDuplicate) {
+            ReportWriter::Finding const F = ToFinding(Current);
+            if (Writer.get()) {
+                Writer->Write(F);
+            } else {
+                Print(*Text, F);
+            }
+            Last = Current;
+            HasLast = true;
+        }
+        if (++Current.Index < Current.File->GetSize()) {
+            Queue.push(Current);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -1,84 +1,120 @@
 // This file is distributed under MIT-LICENSE. See COPYING for details.
 
+#define DEBUG_TYPE "constantine"
+
 #include "ModuleAnalysis.hpp"
 
+#include "AnalysisCache.hpp"
 #include "DeclarationCollector.hpp"
+#include "FieldFacts.hpp"
+#include "FunctionProfile.hpp"
+#include "MemoryAccounting.hpp"
+#include "ReportSink.hpp"
+#include "ReportWriter.hpp"
 #include "ScopeAnalysis.hpp"
-#include "IsCXXThisExpr.hpp"
+#include "SourceFilter.hpp"
+#include "Statistics.hpp"
+#include "ThreadPool.hpp"
 
-#include <iterator>
-#include <map>
 #include <memory>
+#include <set>
+#include <string>
+#include <vector>
 
 #include <clang/AST/AST.h>
 #include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Basic/FileManager.h>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/Allocator.h>
+#include <llvm/Support/raw_ostream.h>
 
 #include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/bind.hpp>
 #include <boost/range.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/range/adaptor/filtered.hpp>
-#include <boost/range/algorithm/copy.hpp>
 #include <boost/range/algorithm/for_each.hpp>
 #include <boost/range/algorithm/count_if.hpp>
 
 
+STATISTIC(NumFunctions, "Number of functions analysed");
+STATISTIC(NumInstantiations, "Number of template instantiations analysed");
+STATISTIC(NumMemoized, "Number of template instantiations taken from the pattern memo");
+STATISTIC(NumDeclarations, "Number of declarations evaluated");
+STATISTIC(NumCacheHits, "Number of function analyses restored from the cache");
+STATISTIC(NumSkipped, "Number of functions skipped without candidates");
+
 namespace {
 
 // Report function for pseudo constness analysis.
-void EmitWarningMessage(clang::DiagnosticsEngine & DE, char const * const M, clang::DeclaratorDecl const * const V) {
-    unsigned const Id =
-        DE.getCustomDiagID(clang::DiagnosticsEngine::Warning, M);
-    clang::DiagnosticBuilder const DB = DE.Report(V->getLocStart(), Id);
-    DB << V->getNameAsString();
-    DB.setForceEmit();
-}
-
-void ReportVariablePseudoConstness(clang::DiagnosticsEngine & DE, clang::DeclaratorDecl const * const V) {
-    static char const * const Message =
-        "variable '%0' could be declared as const";
-    EmitWarningMessage(DE, Message, V);
+void ReportVariablePseudoConstness(ReportSink & Sink, clang::DeclaratorDecl const * const V) {
+    Sink.Add(ReportSink::VariablePseudoConstness, V);
 }
 
-void ReportFunctionPseudoConstness(clang::DiagnosticsEngine & DE, clang::DeclaratorDecl const * const V) {
-    static char const * const Message =
-        "function '%0' could be declared as const";
-    EmitWarningMessage(DE, Message, V);
+void ReportFunctionPseudoConstness(ReportSink & Sink, clang::DeclaratorDecl const * const V) {
+    Sink.Add(ReportSink::FunctionPseudoConstness, V);
 }
 
-void ReportFunctionPseudoStaticness(clang::DiagnosticsEngine & DE, clang::DeclaratorDecl const * const V) {
-    static char const * const Message =
-        "function '%0' could be declared as static";
-    EmitWarningMessage(DE, Message, V);
+void ReportFunctionPseudoStaticness(ReportSink & Sink, clang::DeclaratorDecl const * const V) {
+    Sink.Add(ReportSink::FunctionPseudoStaticness, V);
 }
 
 // Report function for debug functionality.
-void EmitNoteMessage(clang::DiagnosticsEngine & DE, char const * const M, clang::DeclaratorDecl const * const V) {
-    unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Note, M);
-    clang::DiagnosticBuilder const DB = DE.Report(V->getLocStart(), Id);
-    DB << V->getNameAsString();
-    DB.setForceEmit();
+void ReportVariableDeclaration(ReportSink & Sink, clang::DeclaratorDecl const * const V) {
+    Sink.Add(ReportSink::VariableDeclaration, V);
 }
 
-void ReportVariableDeclaration(clang::DiagnosticsEngine & DE, clang::DeclaratorDecl const * const V) {
-    static char const * const Message = "variable '%0' declared here";
-    EmitNoteMessage(DE, Message, V);
-}
-
-void ReportFunctionDeclaration(clang::DiagnosticsEngine & DE, clang::DeclaratorDecl const * const V) {
-    static char const * const Message = "function '%0' declared here";
-    EmitNoteMessage(DE, Message, V);
+void ReportFunctionDeclaration(ReportSink & Sink, clang::DeclaratorDecl const * const V) {
+    Sink.Add(ReportSink::FunctionDeclaration, V);
 }
 
 
 // helper method not to be so verbose.
-struct IsItFromMainModule {
+struct IsItAnalysed {
+    IsItAnalysed(AnalysedFiles & InFiles)
+        : Files(&InFiles)
+    { }
+
     bool operator()(clang::Decl const * const D) const {
-        clang::SourceManager const & SM = D->getASTContext().getSourceManager();
-        return SM.isFromMainFile(D->getLocation());
+        return Files->Contains(D);
     }
+
+private:
+    AnalysedFiles * Files;
 };
 
+// The template declaration which the function was instantiated from.
+// (Explicit specializations are not instantiations.)
+clang::FunctionDecl const * GetInstantiationPattern(clang::FunctionDecl const * const F) {
+    clang::FunctionDecl const * const Pattern = F->getTemplateInstantiationPattern();
+    return (F != Pattern) ? Pattern : 0;
+}
+
+// A variable is settled, when it is const and does not give a way to change
+// an other one. The analysis can't find these, and their changes are not
+// interesting. References and pointers are never settled, because a change
+// through them (even through a const_cast) changes their referees.
+bool IsSettled(clang::DeclaratorDecl const * const D) {
+    clang::QualType const & T = D->getType();
+    if ((*T).isReferenceType() || (*T).isPointerType()) {
+        return false;
+    }
+    return T.isConstQualified();
+}
+
+Variables GetUnsettled(Variables const & Vs) {
+    Variables Result;
+    for (Variables::const_iterator It(Vs.begin()), End(Vs.end()); It != End; ++It) {
+        if (! IsSettled(*It)) {
+            Result.insert(*It);
+        }
+    }
+    return Result;
+}
+
 bool IsJustAMethod(clang::CXXMethodDecl const * const F) {
     return
         (F->isUserProvided())
@@ -90,34 +126,163 @@ bool IsJustAMethod(clang::CXXMethodDecl const * const F) {
 }
 
 
+// Collects the declarations of a template pattern which are used in a
+// dependent expression. Only those might be used differently by the
+// instantiations, the others are used the same way by all of them.
+class DependentUsages
+    : public boost::noncopyable
+    , public clang::RecursiveASTVisitor<DependentUsages> {
+public:
+    DependentUsages(Variables & InOut)
+        : boost::noncopyable()
+        , clang::RecursiveASTVisitor<DependentUsages>()
+        , Out(InOut)
+        , Depth(0)
+        , Found(false)
+    { }
+
+    bool TraverseStmt(clang::Stmt * const S) {
+        clang::Expr const * const E = clang::dyn_cast_or_null<clang::Expr const>(S);
+        unsigned const Dependent = (E && (E->isTypeDependent() || E->isValueDependent())) ? 1 : 0;
+        Depth += Dependent;
+        Found = Found || Dependent;
+        bool const Result = clang::RecursiveASTVisitor<DependentUsages>::TraverseStmt(S);
+        Depth -= Dependent;
+        return Result;
+    }
+
+    bool VisitDeclRefExpr(clang::DeclRefExpr const * const E) {
+        Add(E->getDecl());
+        return true;
+    }
+    bool VisitMemberExpr(clang::MemberExpr const * const E) {
+        Add(E->getMemberDecl());
+        return true;
+    }
+
+    // is there any dependent expression in the pattern.
+    bool HasDependentExpression() const {
+        return Found;
+    }
+
+private:
+    void Add(clang::ValueDecl const * const D) {
+        if (0 == Depth) {
+            return;
+        }
+        if (clang::DeclaratorDecl const * const DD =
+                clang::dyn_cast<clang::DeclaratorDecl const>(D->getCanonicalDecl())) {
+            Out.insert(DD);
+        }
+    }
+
+private:
+    Variables & Out;
+    unsigned Depth;
+    bool Found;
+};
+
+
 // Pseudo constness analysis detects what variable can be declare as const.
 // This analysis runs through multiple scopes. We need to store the state of
 // the ongoing analysis. Once the variable was changed can't be const.
 class PseudoConstnessAnalysisState : public boost::noncopyable {
 public:
-    PseudoConstnessAnalysisState()
+    PseudoConstnessAnalysisState(AliasGraph & InAliases)
         : boost::noncopyable()
+        , Aliases(InAliases)
         , Candidates()
         , Changed()
     { }
 
-    void Eval(ScopeAnalysis const & Analysis, clang::DeclaratorDecl const * const V) {
+    void Eval(ScopeSummary const & Analysis, clang::DeclaratorDecl const * const V) {
+        ++NumDeclarations;
         if (Analysis.WasChanged(V)) {
-            boost::for_each(GetReferedVariables(V),
-                boost::bind(&PseudoConstnessAnalysisState::RegisterChange, this, _1));
-        } else if (Changed.end() == Changed.find(V)) {
+            RegisterChanges(V);
+        } else if (! Changed.count(V)) {
             if (! IsConst(*V)) {
                 Candidates.insert(V);
             }
         }
     }
 
-    void GenerateReports(clang::DiagnosticsEngine & DE) const {
-        boost::for_each(Candidates | boost::adaptors::filtered(IsItFromMainModule()),
-            boost::bind(ReportVariablePseudoConstness, boost::ref(DE), _1));
+    // The result does not depend on the order of evaluation: a variable
+    // is candidate when it was evaluated unchanged and was never changed.
+    void Merge(PseudoConstnessAnalysisState const & Other) {
+        Changed.insert(Other.Changed.begin(), Other.Changed.end());
+        for (Variables::const_iterator It(Other.Candidates.begin()), End(Other.Candidates.end()); It != End; ++It) {
+            if (! Changed.count(*It)) {
+                Candidates.insert(*It);
+            }
+        }
+        for (Variables::const_iterator It(Other.Changed.begin()), End(Other.Changed.end()); It != End; ++It) {
+            Candidates.erase(*It);
+        }
+    }
+
+    // The variable and the ones it refers to can't be const.
+    void RegisterChanges(clang::DeclaratorDecl const * const V) {
+        Variables Refs;
+        Aliases.GetReferedVariables(V, Refs);
+        boost::for_each(Refs,
+            boost::bind(&PseudoConstnessAnalysisState::RegisterChange, this, _1));
+    }
+
+    bool IsDecided(clang::DeclaratorDecl const * const V) const {
+        return IsConst(*V) || Changed.count(V);
+    }
+
+    std::size_t GetMemorySize() const {
+        return ::GetMemorySize(Candidates) + ::GetMemorySize(Changed);
+    }
+
+    // The member variables are left out, when those are decided by the
+    // facts of the whole program.
+    void GenerateReports(ReportSink & Sink, AnalysedFiles & Files, bool const WithoutMembers) const {
+        boost::for_each(Candidates
+                | boost::adaptors::filtered(IsItAnalysed(Files))
+                | boost::adaptors::filtered(boost::bind(IsReported, _1, WithoutMembers)),
+            boost::bind(ReportVariablePseudoConstness, boost::ref(Sink), _1));
+    }
+
+    void GenerateFacts(FieldFacts & Facts, AnalysedFiles & Files, clang::SourceManager const & Sources) const {
+        for (Variables::const_iterator It(Candidates.begin()), End(Candidates.end()); It != End; ++It) {
+            if (Files.Contains(*It)) {
+                AddFact(Facts, FieldFact::Candidate, *It, Sources);
+            }
+        }
+        for (Variables::const_iterator It(Changed.begin()), End(Changed.end()); It != End; ++It) {
+            AddFact(Facts, FieldFact::Changed, *It, Sources);
+        }
     }
 
 private:
+    static bool IsReported(clang::DeclaratorDecl const * const D, bool const WithoutMembers) {
+        return (! WithoutMembers) || (! clang::isa<clang::FieldDecl>(D));
+    }
+
+    static void AddFact(FieldFacts & Facts,
+                        FieldFact::Kind const What,
+                        clang::DeclaratorDecl const * const D,
+                        clang::SourceManager const & Sources) {
+        clang::FieldDecl const * const Field = clang::dyn_cast<clang::FieldDecl const>(D);
+        if (! Field) {
+            return;
+        }
+        clang::PresumedLoc const Loc = Sources.getPresumedLoc(Field->getLocStart());
+        FieldFact Fact;
+        Fact.What = What;
+        Fact.Key = Field->getQualifiedNameAsString();
+        if (Field->getParent()->isInAnonymousNamespace() && Loc.isValid()) {
+            Fact.Key = std::string(Loc.getFilename()) + ":" + Fact.Key;
+        }
+        Fact.Name = Field->getNameAsString();
+        Fact.File = Loc.isValid() ? Loc.getFilename() : "";
+        Fact.Line = Loc.isValid() ? Loc.getLine() : 0;
+        Fact.Column = Loc.isValid() ? Loc.getColumn() : 0;
+        Facts.push_back(Fact);
+    }
+
     static bool IsConst(clang::DeclaratorDecl const & D) {
         return (D.getType().getNonReferenceType().isConstQualified());
     }
@@ -128,6 +293,7 @@ private:
     }
 
 private:
+    AliasGraph & Aliases;
     Variables Candidates;
     Variables Changed;
 };
@@ -137,23 +303,72 @@ private:
 // functions only once. The traversal algorithm is calling all methods, which is
 // not desired. In case of a CXXMethodDecl, it was calling the VisitFunctionDecl
 // and the VisitCXXMethodDecl as well. This dispatching is reworked in this class.
+//
+// Functions which are not in the analysed files are skipped here, before
+// any analysis would run on them.
 class ModuleVisitor
     : public boost::noncopyable
     , public clang::RecursiveASTVisitor<ModuleVisitor> {
 public:
     typedef std::auto_ptr<ModuleVisitor> Ptr;
-    static ModuleVisitor::Ptr CreateVisitor(Target);
+    static ModuleVisitor::Ptr CreateVisitor(Options const &, AnalysedFiles &, llvm::BumpPtrAllocator &, AnalysisCache *);
 
     virtual ~ModuleVisitor()
     { }
 
+protected:
+    ModuleVisitor(AnalysedFiles & InFiles,
+                  llvm::BumpPtrAllocator & InArena,
+                  bool const InWithInstantiations = false)
+        : boost::noncopyable()
+        , clang::RecursiveASTVisitor<ModuleVisitor>()
+        , Files(InFiles)
+        , Arena(InArena)
+        , WithInstantiations(InWithInstantiations)
+        , Streaming(false)
+        , OnlyInstantiations(false)
+        , Templates()
+    { }
+
 public:
+    // By default only the template patterns are visited. While streaming,
+    // the templates are not instantiated yet.
+    bool shouldVisitTemplateInstantiations() const {
+        return WithInstantiations && (! Streaming);
+    }
+
+    // A top level declaration is traversed as soon as it was parsed. The
+    // templates are kept, and their instantiations are traversed at the
+    // end of the translation unit.
+    void TraverseStreamed(clang::Decl * const D) {
+        Streaming = true;
+        TraverseDecl(D);
+        Streaming = false;
+    }
+
+    void TraverseDeferred() {
+        OnlyInstantiations = true;
+        for (std::vector<clang::Decl *>::const_iterator It(Templates.begin()), End(Templates.end()); It != End; ++It) {
+            TraverseDecl(*It);
+        }
+        OnlyInstantiations = false;
+        Templates.clear();
+    }
+
     // public visitor method.
     bool VisitFunctionDecl(clang::FunctionDecl const * const F) {
         if (! (F->isThisDeclarationADefinition()))
             return true;
+        if (! Files.Contains(F))
+            return true;
+
+        clang::FunctionDecl const * const P = GetInstantiationPattern(F);
+        if (OnlyInstantiations && (! P))
+            return true;
 
-        if (clang::CXXMethodDecl const * const D = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+        if (P) {
+            OnInstantiation(F, P);
+        } else if (clang::CXXMethodDecl const * const D = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
             OnCXXMethodDecl(D);
         } else {
             OnFunctionDecl(F);
@@ -163,16 +378,60 @@ public:
 
 public:
     // interface methods with different visibilities.
-    virtual void Dump(clang::DiagnosticsEngine &) const = 0;
+    virtual void OnEndOfTranslationUnit()
+    { }
+
+    virtual void Dump(ReportSink &) const = 0;
+
+    // The facts of the member variables for the whole program analysis.
+    virtual void DumpFacts(FieldFacts &, clang::SourceManager const &) const
+    { }
 
 protected:
     virtual void OnFunctionDecl(clang::FunctionDecl const *) = 0;
     virtual void OnCXXMethodDecl(clang::CXXMethodDecl const *) = 0;
+    virtual void OnInstantiation(clang::FunctionDecl const *, clang::FunctionDecl const *)
+    { }
+
+public:
+    bool VisitFunctionTemplateDecl(clang::FunctionTemplateDecl * const D) {
+        Defer(D);
+        return true;
+    }
+
+    bool VisitClassTemplateDecl(clang::ClassTemplateDecl * const D) {
+        Defer(D);
+        return true;
+    }
+
+private:
+    // The member templates of a class template are traversed with it.
+    void Defer(clang::TemplateDecl * const D) {
+        if (Streaming && WithInstantiations && (! D->getDeclContext()->isDependentContext())) {
+            Templates.push_back(D);
+        }
+    }
+
+protected:
+    AnalysedFiles & Files;
+    llvm::BumpPtrAllocator & Arena;
+    bool const WithInstantiations;
+
+private:
+    bool Streaming;
+    bool OnlyInstantiations;
+    std::vector<clang::Decl *> Templates;
 };
 
 
 class DebugFunctionDeclarations
     : public ModuleVisitor {
+public:
+    DebugFunctionDeclarations(AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena)
+        : ModuleVisitor(Files, Arena)
+        , Functions()
+    { }
+
 protected:
     void OnFunctionDecl(clang::FunctionDecl const * const F) {
         Functions.insert(F);
@@ -182,9 +441,9 @@ protected:
         Functions.insert(F);
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
+    void Dump(ReportSink & Sink) const {
         boost::for_each(Functions,
-            boost::bind(ReportFunctionDeclaration, boost::ref(DE), _1));
+            boost::bind(ReportFunctionDeclaration, boost::ref(Sink), _1));
     }
 
 protected:
@@ -194,22 +453,28 @@ protected:
 
 class DebugVariableDeclarations
     : public ModuleVisitor {
+public:
+    DebugVariableDeclarations(AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena)
+        : ModuleVisitor(Files, Arena)
+        , Result()
+    { }
+
 private:
     void OnFunctionDecl(clang::FunctionDecl const * const F) {
-        boost::copy(GetVariablesFromContext(F),
-            std::insert_iterator<Variables>(Result, Result.begin()));
+        Variables const & Locals = GetVariablesFromContext(F);
+        Result.insert(Locals.begin(), Locals.end());
     }
 
     void OnCXXMethodDecl(clang::CXXMethodDecl const * const F) {
-        boost::copy(GetVariablesFromContext(F, (! IsJustAMethod(F))),
-            std::insert_iterator<Variables>(Result, Result.begin()));
-        boost::copy(GetVariablesFromRecord(F->getParent()->getCanonicalDecl()),
-            std::insert_iterator<Variables>(Result, Result.begin()));
+        Variables const & Locals = GetVariablesFromContext(F, (! IsJustAMethod(F)));
+        Result.insert(Locals.begin(), Locals.end());
+        Variables const & Members = GetVariablesFromRecord(F->getParent()->getCanonicalDecl());
+        Result.insert(Members.begin(), Members.end());
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
+    void Dump(ReportSink & Sink) const {
         boost::for_each(Result,
-            boost::bind(ReportVariableDeclaration, boost::ref(DE), _1));
+            boost::bind(ReportVariableDeclaration, boost::ref(Sink), _1));
     }
 
 private:
@@ -219,97 +484,469 @@ private:
 
 class DebugVariableUsages
     : public DebugFunctionDeclarations {
+public:
+    DebugVariableUsages(AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena)
+        : DebugFunctionDeclarations(Files, Arena)
+    { }
+
 private:
-    static void ReportVariableUsage(clang::DiagnosticsEngine & DE, clang::FunctionDecl const * const F) {
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        Analysis.DebugReferenced(DE);
+    static void ReportVariableUsage(clang::DiagnosticsEngine & DE, AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena, clang::FunctionDecl const * const F) {
+        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()), Arena);
+        Analysis.DebugReferenced(DE, Files);
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
+    void Dump(ReportSink & Sink) const {
         boost::for_each(Functions,
-            boost::bind(ReportVariableUsage, boost::ref(DE), _1));
+            boost::bind(ReportVariableUsage, boost::ref(Sink.GetEngine()), boost::ref(Files), boost::ref(Arena), _1));
     }
 };
 
 
 class DebugVariableChanges
     : public DebugFunctionDeclarations {
+public:
+    DebugVariableChanges(AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena)
+        : DebugFunctionDeclarations(Files, Arena)
+    { }
+
 private:
-    static void ReportVariableUsage(clang::DiagnosticsEngine & DE, clang::FunctionDecl const * const F) {
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        Analysis.DebugChanged(DE);
+    static void ReportVariableUsage(clang::DiagnosticsEngine & DE, AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena, clang::FunctionDecl const * const F) {
+        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()), Arena);
+        Analysis.DebugChanged(DE, Files);
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
+    void Dump(ReportSink & Sink) const {
         boost::for_each(Functions,
-            boost::bind(ReportVariableUsage, boost::ref(DE), _1));
+            boost::bind(ReportVariableUsage, boost::ref(Sink.GetEngine()), boost::ref(Files), boost::ref(Arena), _1));
     }
 };
 
 
-class AnalyseVariableUsage
-    : public ModuleVisitor {
-private:
+// The pseudo constness analysis of functions. Instances which analysed
+// different functions of the same translation unit can be merged.
+//
+// The scope analysis of a function body is taken from the cache, when
+// the function was analysed already by an other translation unit.
+//
+// Template instantiations are analysed against their pattern: the findings
+// are reported on the pattern, and an instantiation can only take away the
+// findings of it. (A local which looks const in the pattern might be changed
+// in an instantiation.) The declarations which are not used in a dependent
+// expression are used the same way by every instantiation, so only the
+// first instantiation decides those. The later ones track only the
+// dependent declarations, and are not analysed at all, when those are
+// decided already (and the verdict of the method can't differ).
+//
+// The cost and the memory of the function analyses are profiled, when
+// their limits were given.
+//
+// When the member variables are decided by the facts of the whole program,
+// the changes of any member variable are registered, not only of the ones
+// of the analysed method. The cache can't restore those, so it's not read
+// in this mode.
+//
+// Functions which can't have a finding are not analysed: every variable
+// of those is settled, and the method is not judged. Otherwise only the
+// usages of the variables which are not settled are recorded.
+class PseudoConstnessAnalysis : public boost::noncopyable {
+public:
+    PseudoConstnessAnalysis(llvm::BumpPtrAllocator & InArena,
+                            AnalysisCache * const InCache,
+                            Options const & Settings)
+        : boost::noncopyable()
+        , Arena(InArena)
+        , Cache(InCache)
+        , WholeProgram(! Settings.FactsDirectory.empty())
+        , Profile(Settings.Profile)
+        , Memory(Settings.Memory)
+        , Records()
+        , Aliases()
+        , State(Aliases)
+        , ConstCandidates()
+        , StaticCandidates()
+        , NotConst()
+        , NotStatic()
+        , Patterns()
+        , PatternIndex()
+    { }
+
+    void Analyse(clang::FunctionDecl const * const F) {
+        if (clang::FunctionDecl const * const P = GetInstantiationPattern(F)) {
+            OnInstantiation(F, P);
+        } else if (clang::CXXMethodDecl const * const D = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+            OnCXXMethodDecl(D);
+        } else {
+            OnFunctionDecl(F);
+        }
+    }
+
     void OnFunctionDecl(clang::FunctionDecl const * const F) {
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        boost::for_each(GetVariablesFromContext(F),
+        Variables const Locals = GetVariablesFromContext(F);
+        Variables const Tracked = GetUnsettled(Locals);
+        if (Tracked.empty() && (! WholeProgram)) {
+            ++NumSkipped;
+            return;
+        }
+        ++NumFunctions;
+        FunctionProfile::Probe Probe(Profile, F);
+        MemoryAccounting::Probe Footprint(Memory, F, Arena);
+        Queries Qs(Locals.begin(), Locals.end());
+        ScopeSummary const Analysis = Summarize(F, Qs, Tracked, Footprint);
+        Probe.SetReferences(Analysis.Referenced.size());
+        Footprint.Add(GetMemorySize(Locals) + Qs.capacity() * sizeof(void *));
+        boost::for_each(Locals,
             boost::bind(&PseudoConstnessAnalysisState::Eval, &State, boost::cref(Analysis), _1));
+        RegisterMemberChanges(Analysis);
+        SampleMemory();
+        Aliases.Clear();
     }
 
     void OnCXXMethodDecl(clang::CXXMethodDecl const * const F) {
         clang::CXXRecordDecl const * const RecordDecl =
             F->getParent()->getCanonicalDecl();
-        Variables const MemberVariables = GetMemberVariablesAndReferences(RecordDecl, F);
+        Variables const Locals = GetVariablesFromContext(F, (! IsJustAMethod(F)));
+        Variables Tracked = GetUnsettled(Locals);
+        if (Tracked.empty() && (! WholeProgram) && (! IsJudged(F))
+            && GetUnsettled(Records.GetVariables(RecordDecl)).empty()
+        ) {
+            ++NumSkipped;
+            return;
+        }
+        ++NumFunctions;
+        FunctionProfile::Probe Probe(Profile, F);
+        MemoryAccounting::Probe Footprint(Memory, F, Arena);
+        Variables const & MemberVariables = Records.GetVariables(RecordDecl);
+        Methods const MemberFunctions = Records.GetMethods(RecordDecl);
+        // the locals which refer to members are judged with the members.
+        Variables MemberReferences;
+        Aliases.GetMemberReferences(MemberVariables, F, MemberReferences);
+        Tracked.insert(MemberReferences.begin(), MemberReferences.end());
+        Queries Qs(Locals.begin(), Locals.end());
+        Qs.append(MemberVariables.begin(), MemberVariables.end());
+        Qs.append(MemberFunctions.begin(), MemberFunctions.end());
         // check variables first,
-        ScopeAnalysis const & Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()));
-        boost::for_each(GetVariablesFromContext(F, (! IsJustAMethod(F))),
+        ScopeSummary const Analysis = Summarize(F, Qs, Tracked, Footprint);
+        Probe.SetReferences(Analysis.Referenced.size());
+        Probe.SetMembers(MemberVariables.size() + MemberFunctions.size());
+        Footprint.Add(GetMemorySize(Locals) + GetMemorySize(MemberReferences) + Qs.capacity() * sizeof(void *));
+        boost::for_each(Locals,
             boost::bind(&PseudoConstnessAnalysisState::Eval, &State, boost::cref(Analysis), _1));
         boost::for_each(MemberVariables,
             boost::bind(&PseudoConstnessAnalysisState::Eval, &State, boost::cref(Analysis), _1));
+        boost::for_each(MemberReferences,
+            boost::bind(&PseudoConstnessAnalysisState::Eval, &State, boost::cref(Analysis), _1));
+        RegisterMemberChanges(Analysis);
         // then check the method itself.
-        if ((! F->isVirtual()) &&
-            (! F->isStatic()) &&
-            F->isUserProvided() &&
-            IsJustAMethod(F)
-        ) {
-            Methods const MemberFunctions = GetMethodsFromRecord(RecordDecl);
-            // check the constness first..
-            unsigned int const MemberChanges =
-                boost::count_if(MemberVariables,
-                    boost::bind(&ScopeAnalysis::WasChanged, &Analysis, _1));
-            unsigned int const FunctionChanges =
-                boost::count_if(
-                    MemberFunctions | boost::adaptors::filtered(IsMutatingMethod()),
-                    boost::bind(&ScopeAnalysis::WasReferenced, &Analysis, _1));
-            // if it looks const, it might be even static..
-            if ((0 == MemberChanges) && (0 == FunctionChanges)) {
-                unsigned int const MemberAccess =
-                    boost::count_if(MemberVariables,
-                        boost::bind(&ScopeAnalysis::WasReferenced, &Analysis, _1));
-                unsigned int const FunctionAccess =
-                    boost::count_if(
-                        MemberFunctions | boost::adaptors::filtered(IsMemberMethod()),
-                        boost::bind(&ScopeAnalysis::WasReferenced, &Analysis, _1));
-                if ((0 == MemberAccess) && (0 == FunctionAccess) &&
-                    (! IsCXXThisExpr::Check(F->getBody()))
-                ) {
-                    StaticCandidates.insert(F);
-                } else if (! F->isConst()) {
+        if (IsJudged(F)) {
+            switch (Judge(Analysis, MemberVariables, MemberReferences, MemberFunctions)) {
+            case CouldBeStatic :
+                StaticCandidates.insert(F);
+                break;
+            case CouldBeConst :
+                if (! F->isConst()) {
                     ConstCandidates.insert(F);
                 }
+                break;
+            case Mutates :
+                break;
             }
         }
+        SampleMemory();
+        Aliases.Clear();
     }
 
-    void Dump(clang::DiagnosticsEngine & DE) const {
-        State.GenerateReports(DE);
-        boost::for_each(ConstCandidates | boost::adaptors::filtered(IsItFromMainModule()),
-            boost::bind(ReportFunctionPseudoConstness, boost::ref(DE), _1));
-        boost::for_each(StaticCandidates | boost::adaptors::filtered(IsItFromMainModule()),
-            boost::bind(ReportFunctionPseudoStaticness, boost::ref(DE), _1));
+    void OnInstantiation(clang::FunctionDecl const * const F, clang::FunctionDecl const * const Pattern) {
+        PatternEntry & Entry = GetPattern(Pattern);
+        if (IsMemoized(Pattern, Entry)) {
+            ++NumMemoized;
+            return;
+        }
+        ++NumInstantiations;
+        FunctionProfile::Probe Probe(Profile, F);
+        MemoryAccounting::Probe Footprint(Memory, F, Arena);
+        Variables Tracked;
+        if (Entry.Analysed) {
+            Variables const & Locals = GetVariablesFromContext(F);
+            for (Variables::const_iterator It(Locals.begin()), End(Locals.end()); It != End; ++It) {
+                llvm::DenseMap<unsigned, clang::DeclaratorDecl const *>::const_iterator const PIt =
+                    Entry.ByLocation.find((*It)->getLocation().getRawEncoding());
+                if ((Entry.ByLocation.end() != PIt) && Entry.Dependent.count(PIt->second)) {
+                    Tracked.insert(*It);
+                }
+            }
+            Footprint.Add(GetMemorySize(Tracked));
+        }
+        ScopeSummary const Analysis = AnalyseBody(F, Footprint, Entry.Analysed ? &Tracked : 0);
+        Entry.Analysed = true;
+        Probe.SetReferences(Analysis.Referenced.size());
+        // the instantiated declarations are at the same location as their
+        // pattern declarations.
+        for (Variables::const_iterator It(Analysis.Changed.begin()), End(Analysis.Changed.end()); It != End; ++It) {
+            llvm::DenseMap<unsigned, clang::DeclaratorDecl const *>::const_iterator const PIt =
+                Entry.ByLocation.find((*It)->getLocation().getRawEncoding());
+            if (Entry.ByLocation.end() != PIt) {
+                State.RegisterChanges(PIt->second);
+            }
+        }
+        RegisterMemberChanges(Analysis);
+        clang::CXXMethodDecl const * const M = clang::dyn_cast<clang::CXXMethodDecl const>(F);
+        clang::CXXMethodDecl const * const PM = clang::dyn_cast<clang::CXXMethodDecl const>(Pattern);
+        if (M && PM && IsJudged(M)) {
+            clang::CXXRecordDecl const * const RecordDecl =
+                M->getParent()->getCanonicalDecl();
+            Variables const & MemberVariables = Records.GetVariables(RecordDecl);
+            Methods const MemberFunctions = Records.GetMethods(RecordDecl);
+            Variables MemberReferences;
+            Aliases.GetMemberReferences(MemberVariables, M, MemberReferences);
+            Probe.SetMembers(MemberVariables.size() + MemberFunctions.size());
+            Footprint.Add(GetMemorySize(MemberReferences));
+            switch (Judge(Analysis, MemberVariables, MemberReferences, MemberFunctions)) {
+            case Mutates :
+                NotConst.insert(PM);
+                NotStatic.insert(PM);
+                break;
+            case CouldBeConst :
+                NotStatic.insert(PM);
+                break;
+            case CouldBeStatic :
+                break;
+            }
+        }
+        SampleMemory();
+        Aliases.Clear();
+    }
+
+    // The body, the locals and the record (with its bases) of a function
+    // are loaded lazily from a precompiled header, which is not thread
+    // safe. Reading them on the main thread loads those for the workers.
+    void Load(clang::FunctionDecl const * const F) {
+        F->getBody();
+        GetVariablesFromContext(F);
+        if (clang::CXXMethodDecl const * const M = clang::dyn_cast<clang::CXXMethodDecl const>(F)) {
+            Records.GetVariables(M->getParent()->getCanonicalDecl());
+        }
+    }
+
+    void Merge(PseudoConstnessAnalysis const & Other) {
+        State.Merge(Other.State);
+        ConstCandidates.insert(Other.ConstCandidates.begin(), Other.ConstCandidates.end());
+        StaticCandidates.insert(Other.StaticCandidates.begin(), Other.StaticCandidates.end());
+        NotConst.insert(Other.NotConst.begin(), Other.NotConst.end());
+        NotStatic.insert(Other.NotStatic.begin(), Other.NotStatic.end());
+        Profile.Merge(Other.Profile);
+        Memory.Merge(Other.Memory);
+        SampleMemory();
+    }
+
+    void GenerateReports(ReportSink & Sink, AnalysedFiles & Files) const {
+        State.GenerateReports(Sink, Files, WholeProgram);
+        boost::for_each(ConstCandidates
+                | boost::adaptors::filtered(IsItAnalysed(Files))
+                | boost::adaptors::filtered(IsNotIn(NotConst)),
+            boost::bind(ReportFunctionPseudoConstness, boost::ref(Sink), _1));
+        boost::for_each(StaticCandidates
+                | boost::adaptors::filtered(IsItAnalysed(Files))
+                | boost::adaptors::filtered(IsNotIn(NotStatic)),
+            boost::bind(ReportFunctionPseudoStaticness, boost::ref(Sink), _1));
+    }
+
+    void GenerateFacts(FieldFacts & Facts, AnalysedFiles & Files, clang::SourceManager const & Sources) const {
+        State.GenerateFacts(Facts, Files, Sources);
+    }
+
+    void PrintProfile(clang::SourceManager const & Sources) const {
+        Profile.Print(Sources, llvm::errs());
+    }
+
+    void PrintMemory(clang::SourceManager const & Sources) const {
+        Memory.Print(Sources, llvm::errs());
     }
 
 private:
+    typedef llvm::SmallVector<clang::DeclaratorDecl const *, 32> Queries;
+
+    // The queries are the declarations which the analysis asks about.
+    // The usages of the settled variables are not recorded, unless the
+    // summary is stored into the cache. (Those serve any later query.)
+    ScopeSummary Summarize(clang::FunctionDecl const * const F,
+                           Queries const & Qs,
+                           Variables const & Tracked,
+                           MemoryAccounting::Probe & Footprint) {
+        ScopeSummary Result;
+        if (Cache && (! WholeProgram) && Cache->Lookup(F, Qs, Result)) {
+            ++NumCacheHits;
+            return Result;
+        }
+        Result = AnalyseBody(F, Footprint, Cache ? 0 : &Tracked);
+        if (Cache) {
+            Cache->Store(F, Result);
+        }
+        return Result;
+    }
+
+    // The usage maps are released with the scope analysis, only the
+    // summary is kept.
+    ScopeSummary AnalyseBody(clang::FunctionDecl const * const F,
+                             MemoryAccounting::Probe & Footprint,
+                             Variables const * const Tracked = 0) {
+        ScopeAnalysis const Analysis = ScopeAnalysis::AnalyseThis(*(F->getBody()), Arena, Tracked);
+        if (Memory.IsEnabled()) {
+            std::size_t const Bytes = Analysis.GetMemorySize();
+            Memory.Sample(MemoryAccounting::UsageMaps, Bytes);
+            Memory.Sample(MemoryAccounting::UsageMaps, 0);
+            Footprint.Add(Bytes);
+        }
+        return Analysis.Summarize();
+    }
+
+    // Member variables of other classes might be changed too.
+    void RegisterMemberChanges(ScopeSummary const & Analysis) {
+        if (! WholeProgram) {
+            return;
+        }
+        for (Variables::const_iterator It(Analysis.Changed.begin()), End(Analysis.Changed.end()); It != End; ++It) {
+            if (clang::isa<clang::FieldDecl>(*It)) {
+                State.RegisterChanges(*It);
+            }
+        }
+    }
+
+    void SampleMemory() {
+        if (! Memory.IsEnabled()) {
+            return;
+        }
+        Memory.Sample(MemoryAccounting::AnalysisState,
+            State.GetMemorySize()
+                + GetMemorySize(ConstCandidates) + GetMemorySize(StaticCandidates)
+                + GetMemorySize(NotConst) + GetMemorySize(NotStatic));
+        Memory.Sample(MemoryAccounting::MemberSets, Records.GetMemorySize() + Aliases.GetMemorySize());
+    }
+
+private:
+    enum Verdict { Mutates, CouldBeConst, CouldBeStatic };
+
+    static bool IsJudged(clang::CXXMethodDecl const * const F) {
+        return (! F->isVirtual())
+            && (! F->isStatic())
+            && F->isUserProvided()
+            && IsJustAMethod(F);
+    }
+
+    // The locals which refer to member variables count as members.
+    static Verdict Judge(ScopeSummary const & Analysis,
+                         Variables const & MemberVariables,
+                         Variables const & MemberReferences,
+                         Methods const & MemberFunctions) {
+        // check the constness first..
+        unsigned int const MemberChanges =
+            boost::count_if(MemberVariables,
+                boost::bind(&ScopeSummary::WasChanged, &Analysis, _1))
+            + boost::count_if(MemberReferences,
+                boost::bind(&ScopeSummary::WasChanged, &Analysis, _1));
+        unsigned int const FunctionChanges =
+            boost::count_if(
+                MemberFunctions | boost::adaptors::filtered(IsMutatingMethod()),
+                boost::bind(&ScopeSummary::WasReferenced, &Analysis, _1));
+        if ((0 != MemberChanges) || (0 != FunctionChanges)) {
+            return Mutates;
+        }
+        // if it looks const, it might be even static..
+        unsigned int const MemberAccess =
+            boost::count_if(MemberVariables,
+                boost::bind(&ScopeSummary::WasReferenced, &Analysis, _1))
+            + boost::count_if(MemberReferences,
+                boost::bind(&ScopeSummary::WasReferenced, &Analysis, _1));
+        unsigned int const FunctionAccess =
+            boost::count_if(
+                MemberFunctions | boost::adaptors::filtered(IsMemberMethod()),
+                boost::bind(&ScopeSummary::WasReferenced, &Analysis, _1));
+        return ((0 == MemberAccess) && (0 == FunctionAccess) && (! Analysis.WasThisReferenced()))
+            ? CouldBeStatic
+            : CouldBeConst;
+    }
+
+    // The memo of a template pattern: its variables by location (which
+    // the instantiations share), the ones which are used in a dependent
+    // expression, and whether an instantiation was analysed already.
+    struct PatternEntry {
+        PatternEntry()
+            : ByLocation()
+            , Dependent()
+            , DependentBody(false)
+            , Analysed(false)
+        { }
+
+        llvm::DenseMap<unsigned, clang::DeclaratorDecl const *> ByLocation;
+        Variables Dependent;
+        bool DependentBody;
+        bool Analysed;
+    };
+
+    PatternEntry & GetPattern(clang::FunctionDecl const * const Pattern) {
+        llvm::DenseMap<clang::FunctionDecl const *, PatternEntry *>::const_iterator const It =
+            PatternIndex.find(Pattern);
+        if (PatternIndex.end() != It) {
+            return *(It->second);
+        }
+        PatternEntry * const Result = new (Patterns.Allocate()) PatternEntry();
+        PatternIndex[Pattern] = Result;
+
+        Variables const & Locals = GetVariablesFromContext(Pattern);
+        for (Variables::const_iterator VIt(Locals.begin()), VEnd(Locals.end()); VIt != VEnd; ++VIt) {
+            Result->ByLocation[(*VIt)->getLocation().getRawEncoding()] = *VIt;
+        }
+        if (clang::CXXMethodDecl const * const PM = clang::dyn_cast<clang::CXXMethodDecl const>(Pattern)) {
+            Variables const & Members = Records.GetVariables(PM->getParent()->getCanonicalDecl());
+            for (Variables::const_iterator VIt(Members.begin()), VEnd(Members.end()); VIt != VEnd; ++VIt) {
+                Result->ByLocation[(*VIt)->getLocation().getRawEncoding()] = *VIt;
+            }
+        }
+        Variables Usages;
+        DependentUsages Visitor(Usages);
+        Visitor.TraverseDecl(const_cast<clang::FunctionDecl *>(Pattern));
+        Result->DependentBody = Visitor.HasDependentExpression();
+        for (llvm::DenseMap<unsigned, clang::DeclaratorDecl const *>::const_iterator VIt(Result->ByLocation.begin()), VEnd(Result->ByLocation.end()); VIt != VEnd; ++VIt) {
+            if (VIt->second->getType()->isDependentType() || Usages.count(VIt->second)) {
+                Result->Dependent.insert(VIt->second);
+            }
+        }
+        return *Result;
+    }
+
+    // The instantiations might change the member variables of any class,
+    // when those are decided by the whole program. Otherwise the first
+    // instantiation decides the declarations which are not dependent, and
+    // the verdict of a method without dependent expressions.
+    bool IsMemoized(clang::FunctionDecl const * const Pattern, PatternEntry const & Entry) const {
+        if (WholeProgram || (! Entry.Analysed)) {
+            return false;
+        }
+        for (Variables::const_iterator It(Entry.Dependent.begin()), End(Entry.Dependent.end()); It != End; ++It) {
+            if (! State.IsDecided(*It)) {
+                return false;
+            }
+        }
+        if (clang::CXXMethodDecl const * const PM = clang::dyn_cast<clang::CXXMethodDecl const>(Pattern)) {
+            if (IsJudged(PM) && Entry.DependentBody && ((! NotConst.count(PM)) || (! NotStatic.count(PM)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct IsNotIn {
+        IsNotIn(Methods const & InExcluded)
+            : Excluded(&InExcluded)
+        { }
+
+        bool operator()(clang::CXXMethodDecl const * const F) const {
+            return (! Excluded->count(F));
+        }
+
+    private:
+        Methods const * Excluded;
+    };
+
     struct IsMutatingMethod {
         bool operator()(clang::CXXMethodDecl const * const F) const {
             return (! F->isStatic()) && (! F->isConst());
@@ -323,39 +960,290 @@ private:
     };
 
 private:
+    llvm::BumpPtrAllocator & Arena;
+    AnalysisCache * const Cache;
+    bool const WholeProgram;
+    FunctionProfile Profile;
+    MemoryAccounting Memory;
+    RecordCache Records;
+    AliasGraph Aliases;
     PseudoConstnessAnalysisState State;
     Methods ConstCandidates;
     Methods StaticCandidates;
+    Methods NotConst;
+    Methods NotStatic;
+    llvm::SpecificBumpPtrAllocator<PatternEntry> Patterns;
+    llvm::DenseMap<clang::FunctionDecl const *, PatternEntry *> PatternIndex;
+};
+
+
+// Runs the analysis of the collected functions on multiple threads. Each
+// thread has its own analysis (with its own arena and record cache), so
+// the threads share nothing, but the read only AST. (The bodies, the locals
+// and the records of the functions and of their template patterns were
+// loaded by the traversal which collected the functions.)
+class ParallelAnalysis : public ThreadPool::Work {
+public:
+    ParallelAnalysis(std::vector<clang::FunctionDecl const *> const & InFunctions,
+                     AnalysisCache * const Cache,
+                     Options const & Settings)
+        : ThreadPool::Work()
+        , Functions(InFunctions)
+        , Workers()
+    {
+        for (unsigned It = 0; It < Settings.Jobs; ++It) {
+            Workers.push_back(new Worker(Cache, Settings));
+        }
+    }
+
+    // only the summary of a function is kept.
+    void Run(unsigned const Thread, unsigned const Task) {
+        Worker & W = Workers[Thread];
+        W.Analysis.Analyse(Functions[Task]);
+        W.Arena.Reset();
+    }
+
+    // merge the thread results in the order of the threads.
+    void MergeInto(PseudoConstnessAnalysis & Result) const {
+        for (boost::ptr_vector<Worker>::const_iterator It(Workers.begin()), End(Workers.end()); It != End; ++It) {
+            Result.Merge(It->Analysis);
+        }
+    }
+
+private:
+    struct Worker : public boost::noncopyable {
+        Worker(AnalysisCache * const Cache, Options const & Settings)
+            : boost::noncopyable()
+            , Arena()
+            , Analysis(Arena, Cache, Settings)
+        { }
+
+        llvm::BumpPtrAllocator Arena;
+        PseudoConstnessAnalysis Analysis;
+    };
+
+    std::vector<clang::FunctionDecl const *> const & Functions;
+    boost::ptr_vector<Worker> Workers;
 };
 
 
-ModuleVisitor::Ptr ModuleVisitor::CreateVisitor(Target const State) {
-    switch (State) {
+class AnalyseVariableUsage
+    : public ModuleVisitor {
+public:
+    AnalyseVariableUsage(AnalysedFiles & Files,
+                         llvm::BumpPtrAllocator & Arena,
+                         AnalysisCache * const InCache,
+                         Options const & InSettings)
+        : ModuleVisitor(Files, Arena, InSettings.Instantiations)
+        , Settings(InSettings)
+        , Jobs(InSettings.Jobs)
+        , Cache(InCache)
+        , Functions()
+        , Analysis(Arena, InCache, InSettings)
+    { }
+
+private:
+    // with multiple jobs the functions are only collected during the
+    // traversal, and analysed at the end of the translation unit. Otherwise
+    // only the summary of a function is kept, its usage nodes are released
+    // right after the analysis.
+    void OnFunctionDecl(clang::FunctionDecl const * const F) {
+        if (1 < Jobs) {
+            Analysis.Load(F);
+            Functions.push_back(F);
+        } else {
+            Analysis.OnFunctionDecl(F);
+            Arena.Reset();
+        }
+    }
+
+    // the declarations of a precompiled header are loaded on this thread.
+    void OnCXXMethodDecl(clang::CXXMethodDecl const * const F) {
+        if (1 < Jobs) {
+            Analysis.Load(F);
+            Functions.push_back(F);
+        } else {
+            Analysis.OnCXXMethodDecl(F);
+            Arena.Reset();
+        }
+    }
+
+    void OnInstantiation(clang::FunctionDecl const * const F, clang::FunctionDecl const * const Pattern) {
+        if (1 < Jobs) {
+            Analysis.Load(F);
+            Analysis.Load(Pattern);
+            Functions.push_back(F);
+        } else {
+            Analysis.OnInstantiation(F, Pattern);
+            Arena.Reset();
+        }
+    }
+
+    void OnEndOfTranslationUnit() {
+        if (Functions.empty()) {
+            return;
+        }
+        ParallelAnalysis Work(Functions, Cache, Settings);
+        ThreadPool::Run(Work, Jobs, Functions.size());
+        Work.MergeInto(Analysis);
+    }
+
+    void Dump(ReportSink & Sink) const {
+        Analysis.GenerateReports(Sink, Files);
+        Analysis.PrintProfile(Sink.GetEngine().getSourceManager());
+        Analysis.PrintMemory(Sink.GetEngine().getSourceManager());
+    }
+
+    void DumpFacts(FieldFacts & Facts, clang::SourceManager const & Sources) const {
+        Analysis.GenerateFacts(Facts, Files, Sources);
+    }
+
+private:
+    Options const & Settings;
+    unsigned const Jobs;
+    AnalysisCache * const Cache;
+    std::vector<clang::FunctionDecl const *> Functions;
+    PseudoConstnessAnalysis Analysis;
+};
+
+
+// The output is named after the main file, when the path was not given.
+std::string GetOutputPath(Options const & Settings, clang::SourceManager const & Sources) {
+    if (! Settings.OutputPath.empty()) {
+        return Settings.OutputPath;
+    }
+    clang::FileEntry const * const Main = Sources.getFileEntryForID(Sources.getMainFileID());
+    std::string const Base = Main ? Main->getName() : "constantine";
+    switch (Settings.Format) {
+    case Sarif :
+        return Base + ".sarif";
+    case Binary :
+        return Base + ".cnst";
+    default :
+        return Base + ".jsonl";
+    }
+}
+
+ReportWriter::Ptr CreateWriter(Options const & Settings, clang::SourceManager const & Sources, clang::DiagnosticsEngine & DE) {
+    if (Diagnostics == Settings.Format) {
+        return ReportWriter::Ptr();
+    }
+    std::string const Path = GetOutputPath(Settings, Sources);
+    std::string Error;
+    ReportWriter::Ptr Result = ReportWriter::Create(Settings.Format, Path, Error);
+    if (! Result.get()) {
+        unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Error,
+            "can't write constantine output '%0': %1");
+        DE.Report(Id) << Path << Error;
+    }
+    return Result;
+}
+
+ModuleVisitor::Ptr ModuleVisitor::CreateVisitor(Options const & Settings, AnalysedFiles & Files, llvm::BumpPtrAllocator & Arena, AnalysisCache * const Cache) {
+    switch (Settings.Debug) {
     case FuncionDeclaration :
-        return ModuleVisitor::Ptr( new DebugFunctionDeclarations() );
+        return ModuleVisitor::Ptr( new DebugFunctionDeclarations(Files, Arena) );
     case VariableDeclaration :
-        return ModuleVisitor::Ptr( new DebugVariableDeclarations() );
+        return ModuleVisitor::Ptr( new DebugVariableDeclarations(Files, Arena) );
     case VariableChanges:
-        return ModuleVisitor::Ptr( new DebugVariableChanges() );
+        return ModuleVisitor::Ptr( new DebugVariableChanges(Files, Arena) );
     case VariableUsages :
-        return ModuleVisitor::Ptr( new DebugVariableUsages() );
+        return ModuleVisitor::Ptr( new DebugVariableUsages(Files, Arena) );
     case PseudoConstness :
-        return ModuleVisitor::Ptr( new AnalyseVariableUsage() );
+        return ModuleVisitor::Ptr( new AnalyseVariableUsage(Files, Arena, Cache, Settings) );
     }
 }
 
 } // namespace anonymous
 
 
-ModuleAnalysis::ModuleAnalysis(clang::CompilerInstance const & Compiler, Target const T)
+// The state of the analysis of a translation unit. It's created before the
+// parsing starts, so the declarations can be analysed while those are
+// parsed.
+struct ModuleAnalysis::Session : public boost::noncopyable {
+    Session(Options const & Settings, clang::ASTContext & Ctx)
+        : boost::noncopyable()
+        , Arena()
+        , Files(*Settings.Filter, Ctx.getSourceManager())
+        , Cache(Settings.CacheDirectory.empty() ? 0 : new AnalysisCache(Settings.CacheDirectory, Ctx))
+        , Visitor(ModuleVisitor::CreateVisitor(Settings, Files, Arena, Cache.get()))
+    { }
+
+    // the storage of the analysis results lives until the end of the
+    // translation unit.
+    llvm::BumpPtrAllocator Arena;
+    AnalysedFiles Files;
+    std::auto_ptr<AnalysisCache> const Cache;
+    ModuleVisitor::Ptr const Visitor;
+};
+
+
+ModuleAnalysis::ModuleAnalysis(clang::CompilerInstance const & Compiler, Options const & InSettings)
     : boost::noncopyable()
     , clang::ASTConsumer()
     , Reporter(Compiler.getDiagnostics())
-    , State(T)
+    , Settings(InSettings)
+    , TopLevelDecls()
+    , Current()
+{
+    clang::FrontendOptions const & Opts = Compiler.getFrontendOpts();
+    if (Settings.Statistics || Opts.ShowStats) {
+        llvm::EnableStatistics();
+    }
+    if (Settings.Statistics || Opts.ShowTimers) {
+        EnableTimers();
+    }
+}
+
+ModuleAnalysis::~ModuleAnalysis()
 { }
 
+void ModuleAnalysis::Initialize(clang::ASTContext & Ctx) {
+    Current.reset(new Session(Settings, Ctx));
+}
+
+bool ModuleAnalysis::HandleTopLevelDecl(clang::DeclGroupRef Decls) {
+    if (Settings.Streaming) {
+        for (clang::DeclGroupRef::iterator It(Decls.begin()), End(Decls.end()); It != End; ++It) {
+            Current->Visitor->TraverseStreamed(*It);
+        }
+    } else {
+        TopLevelDecls.insert(TopLevelDecls.end(), Decls.begin(), Decls.end());
+    }
+    return true;
+}
+
 void ModuleAnalysis::HandleTranslationUnit(clang::ASTContext & Ctx) {
-    ModuleVisitor::Ptr const V = ModuleVisitor::CreateVisitor(State);
-    V->TraverseDecl(Ctx.getTranslationUnitDecl());
-    V->Dump(Reporter);
+    ModuleVisitor::Ptr const & V = Current->Visitor;
+    for (std::vector<clang::Decl *>::const_iterator It(TopLevelDecls.begin()), End(TopLevelDecls.end()); It != End; ++It) {
+        V->TraverseDecl(*It);
+    }
+    V->TraverseDeferred();
+    V->OnEndOfTranslationUnit();
+    {
+        PhaseTimer const Timer(Reporting);
+        ReportWriter::Ptr const Writer = CreateWriter(Settings, Ctx.getSourceManager(), Reporter);
+        ReportSink Sink(Reporter, Writer.get());
+        if (! Settings.Checks.empty()) {
+            Sink.Select(Settings.Checks);
+        }
+        V->Dump(Sink);
+        Sink.Flush();
+    }
+    if (! Settings.FactsDirectory.empty()) {
+        FieldFacts Facts;
+        V->DumpFacts(Facts, Ctx.getSourceManager());
+        std::string Error;
+        clang::SourceManager const & Sources = Ctx.getSourceManager();
+        clang::FileEntry const * const Main = Sources.getFileEntryForID(Sources.getMainFileID());
+        if (! WriteFieldFacts(Settings.FactsDirectory, Main ? Main->getName() : "<stdin>", Facts, Error)) {
+            unsigned const Id = Reporter.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                "can't write constantine facts '%0': %1");
+            Reporter.Report(Id) << Settings.FactsDirectory << Error;
+        }
+    }
+    if (Current->Cache.get()) {
+        Current->Cache->Flush();
+    }
+    Current.reset();
 }
@@ -3,10 +3,18 @@
 #ifndef _ModuleAnalysis_hpp_
 #define _ModuleAnalysis_hpp_
 
+#include "OutputFormat.hpp"
+
+#include <string>
+#include <vector>
+
 #include <clang/AST/ASTConsumer.h>
+#include <clang/AST/DeclGroup.h>
 #include <clang/Basic/Diagnostic.h>
 #include <clang/Frontend/CompilerInstance.h>
 
+#include <llvm/ADT/OwningPtr.h>
+
 #include <boost/noncopyable.hpp>
 
 enum Target
@@ -17,16 +25,78 @@ enum Target
     , PseudoConstness
     };
 
+class SourceFilter;
+
+// The settings of the analysis, given as plugin arguments.
+struct Options {
+    Options()
+        : Debug(PseudoConstness)
+        , Filter(0)
+        , Jobs(1)
+        , CacheDirectory()
+        , Instantiations(false)
+        , Format(Diagnostics)
+        , OutputPath()
+        , Statistics(false)
+        , Profile(0)
+        , Memory(0)
+        , FactsDirectory()
+        , Checks()
+        , Streaming(false)
+    { }
+
+    Target Debug;
+    SourceFilter * Filter;
+    unsigned Jobs;
+    // the analysis of headers is not cached, when it's empty.
+    std::string CacheDirectory;
+    // analyse the template instantiations too, not only the patterns.
+    bool Instantiations;
+    // the output file is named after the main file, when it's empty.
+    OutputFormat Format;
+    std::string OutputPath;
+    // count and time the phases of the analysis.
+    bool Statistics;
+    // the number of the most expensive functions to print, none when zero.
+    unsigned Profile;
+    // the number of the largest functions to print with the memory of the
+    // analysis, nothing is accounted when zero.
+    unsigned Memory;
+    // the member variables are decided by the facts of the whole program,
+    // when it's given. The facts are written into this directory.
+    std::string FactsDirectory;
+    // the rules of the reported warnings, all of them when it's empty.
+    std::vector<std::string> Checks;
+    // analyse the top level declarations as soon as those were parsed.
+    bool Streaming;
+};
+
 // It runs the pseudo const analysis on the given translation unit.
+//
+// Only the top level declarations which were parsed by this translation
+// unit are traversed. (Traversing the translation unit declaration would
+// load every declaration of a precompiled header or module.) The records
+// of those are loaded only when a method needs them.
+//
+// In streaming mode the top level declarations are traversed as soon as
+// those were parsed. The findings are decided at the end of the
+// translation unit in both modes.
 class ModuleAnalysis : public boost::noncopyable, public clang::ASTConsumer {
 public:
-    ModuleAnalysis(clang::CompilerInstance const &, Target);
+    ModuleAnalysis(clang::CompilerInstance const &, Options const &);
+    ~ModuleAnalysis();
 
+    void Initialize(clang::ASTContext &);
+    bool HandleTopLevelDecl(clang::DeclGroupRef);
     void HandleTranslationUnit(clang::ASTContext &);
 
 private:
+    struct Session;
+
     clang::DiagnosticsEngine & Reporter;
-    Target const State;
+    Options const Settings;
+    std::vector<clang::Decl *> TopLevelDecls;
+    llvm::OwningPtr<Session> Current;
 };
 
 #endif // _ModuleAnalysis_hpp_
@@ -0,0 +1,14 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _OutputFormat_hpp_
+#define _OutputFormat_hpp_
+
+// The findings are emitted as compiler diagnostics by default.
+enum OutputFormat
+    { Diagnostics
+    , JsonLines
+    , Sarif
+    , Binary
+    };
+
+#endif // _OutputFormat_hpp_
@@ -1,6 +1,8 @@
 // This file is distributed under MIT-LICENSE. See COPYING for details.
 
 #include "ModuleAnalysis.hpp"
+#include "ReportSink.hpp"
+#include "SourceFilter.hpp"
 
 #include <iterator>
 
@@ -36,7 +38,7 @@ public:
     Plugin()
         : boost::noncopyable()
         , clang::PluginASTAction()
-        , Debug(PseudoConstness)
+        , Settings()
     { }
 
 private:
@@ -49,12 +51,12 @@ private:
     // ..:: Entry point for plugins ::..
     clang::ASTConsumer * CreateASTConsumer(clang::CompilerInstance & C, llvm::StringRef) {
         return IsCPlusPlus(C)
-            ? (clang::ASTConsumer *) new ModuleAnalysis(C, Debug)
+            ? (clang::ASTConsumer *) new ModuleAnalysis(C, Settings)
             : (clang::ASTConsumer *) new NullConsumer();
     }
 
     // ..:: Entry point for plugins ::..
-    bool ParseArgs(clang::CompilerInstance const &,
+    bool ParseArgs(clang::CompilerInstance const & Compiler,
                    std::vector<std::string> const & Args) {
         std::vector<char const *> ArgPtrs;
         {
@@ -76,16 +78,113 @@ private:
                         clEnumVal(VariableChanges, "Enable variable change detection"),
                         clEnumVal(VariableUsages, "Enable variable usage detection"),
                         clEnumValEnd));
+            static llvm::cl::list<std::string> const
+                IncludeParser("constantine-include",
+                    llvm::cl::desc("Analyse files which path matches the given regex"),
+                    llvm::cl::ZeroOrMore);
+            static llvm::cl::list<std::string> const
+                ExcludeParser("constantine-exclude",
+                    llvm::cl::desc("Skip files which path matches the given regex"),
+                    llvm::cl::ZeroOrMore);
+            static llvm::cl::opt<bool> const
+                SystemHeadersParser("constantine-system-headers",
+                    llvm::cl::desc("Analyse system headers which match the include patterns"),
+                    llvm::cl::init(false));
+            static llvm::cl::opt<unsigned> const
+                JobsParser("constantine-jobs",
+                    llvm::cl::desc("Analyse the functions of a translation unit on the given number of threads"),
+                    llvm::cl::init(1));
+            static llvm::cl::opt<std::string> const
+                CacheParser("constantine-cache",
+                    llvm::cl::desc("Keep the analysis of functions in the given directory"),
+                    llvm::cl::init(""));
+            static llvm::cl::opt<OutputFormat> const
+                FormatParser("constantine-format",
+                    llvm::cl::desc("Write the findings in the given format:"),
+                    llvm::cl::init(Diagnostics),
+                    llvm::cl::values(
+                        clEnumValN(Diagnostics, "diagnostics", "Emit compiler diagnostics"),
+                        clEnumValN(JsonLines, "jsonl", "Append JSON Lines to the output file"),
+                        clEnumValN(Sarif, "sarif", "Write a SARIF log into the output file"),
+                        clEnumValN(Binary, "binary", "Write a binary result file, for constantine-merge"),
+                        clEnumValEnd));
+            static llvm::cl::opt<std::string> const
+                OutputParser("constantine-output",
+                    llvm::cl::desc("The output file of the findings"),
+                    llvm::cl::init(""));
+            static llvm::cl::opt<bool> const
+                InstantiationsParser("constantine-instantiations",
+                    llvm::cl::desc("Analyse the template instantiations too"),
+                    llvm::cl::init(false));
+            static llvm::cl::opt<bool> const
+                StatisticsParser("constantine-stats",
+                    llvm::cl::desc("Print the statistics and the timers of the analysis"),
+                    llvm::cl::init(false));
+            static llvm::cl::opt<unsigned> const
+                ProfileParser("constantine-profile",
+                    llvm::cl::desc("Print the given number of most expensive functions"),
+                    llvm::cl::init(0));
+            static llvm::cl::opt<unsigned> const
+                MemoryParser("constantine-memory",
+                    llvm::cl::desc("Print the memory of the analysis with the given number of largest functions"),
+                    llvm::cl::init(0));
+            static llvm::cl::opt<std::string> const
+                FactsParser("constantine-field-facts",
+                    llvm::cl::desc("Write the member variable facts into the given directory, for constantine-fields"),
+                    llvm::cl::init(""));
+            static llvm::cl::list<std::string> const
+                ChecksParser("constantine-checks",
+                    llvm::cl::desc("Report only the warnings of the given rules"),
+                    llvm::cl::CommaSeparated);
+            static llvm::cl::opt<bool> const
+                StreamingParser("constantine-streaming",
+                    llvm::cl::desc("Analyse the top level declarations while the translation unit is parsed"),
+                    llvm::cl::init(false));
 
             llvm::cl::ParseCommandLineOptions(ArgPtrs.size(), &ArgPtrs.front());
 
-            Debug = DebugParser;
+            // the patterns are compiled only once per process.
+            static SourceFilter
+                Filter(IncludeParser, ExcludeParser, SystemHeadersParser);
+
+            Settings.Debug = DebugParser;
+            Settings.Filter = &Filter;
+            Settings.Jobs = JobsParser;
+            Settings.CacheDirectory = CacheParser;
+            Settings.Instantiations = InstantiationsParser;
+            Settings.Format = FormatParser;
+            Settings.OutputPath = OutputParser;
+            Settings.Statistics = StatisticsParser;
+            Settings.Profile = ProfileParser;
+            Settings.Memory = MemoryParser;
+            Settings.FactsDirectory = FactsParser;
+            Settings.Checks.assign(ChecksParser.begin(), ChecksParser.end());
+            Settings.Streaming = StreamingParser;
+        }
+        for (std::vector<std::string>::const_iterator It(Settings.Checks.begin()), End(Settings.Checks.end()); It != End; ++It) {
+            if (! ReportSink::IsRule(*It)) {
+                clang::DiagnosticsEngine & DE = Compiler.getDiagnostics();
+                unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                    "unknown constantine check: %0");
+                DE.Report(Id) << *It;
+                return false;
+            }
+        }
+        {
+            std::string Error;
+            if (! Settings.Filter->IsValid(Error)) {
+                clang::DiagnosticsEngine & DE = Compiler.getDiagnostics();
+                unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Error,
+                    "invalid constantine file pattern: %0");
+                DE.Report(Id) << Error;
+                return false;
+            }
         }
         return true;
     }
 
 private:
-    Target Debug;
+    Options Settings;
 };
 
 } // namespace anonymous
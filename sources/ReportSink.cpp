@@ -0,0 +1,125 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "ReportSink.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include <clang/Basic/SourceManager.h>
+
+#include <llvm/ADT/StringRef.h>
+
+namespace {
+
+struct Message {
+    clang::DiagnosticsEngine::Level Level;
+    char const * Rule;
+    char const * Text;
+};
+
+// The name of the declaration is quoted by the diagnostic engine.
+Message const Messages[ReportSink::KindCount] =
+    { { clang::DiagnosticsEngine::Warning, "variable-const", "variable %0 could be declared as const" }
+    , { clang::DiagnosticsEngine::Warning, "function-const", "function %0 could be declared as const" }
+    , { clang::DiagnosticsEngine::Warning, "function-static", "function %0 could be declared as static" }
+    , { clang::DiagnosticsEngine::Note, "variable-declaration", "variable %0 declared here" }
+    , { clang::DiagnosticsEngine::Note, "function-declaration", "function %0 declared here" }
+    };
+
+// Format the message, the same way as the diagnostic engine does.
+std::string FormatMessage(char const * const Text, std::string const & Name) {
+    llvm::StringRef const Format(Text);
+    std::pair<llvm::StringRef, llvm::StringRef> const Parts = Format.split("%0");
+    return Parts.first.str() + "'" + Name + "'" + Parts.second.str();
+}
+
+} // namespace anonymous
+
+
+struct ReportSink::IsBefore {
+    IsBefore(clang::SourceManager const & InSources)
+        : Sources(&InSources)
+    { }
+
+    bool operator()(Finding const & Lhs, Finding const & Rhs) const {
+        if (Lhs.Location == Rhs.Location) {
+            return (Lhs.What < Rhs.What);
+        }
+        if (Lhs.Location.isInvalid() || Rhs.Location.isInvalid()) {
+            return Lhs.Location.isInvalid();
+        }
+        return Sources->isBeforeInTranslationUnit(Lhs.Location, Rhs.Location);
+    }
+
+private:
+    clang::SourceManager const * Sources;
+};
+
+
+ReportSink::ReportSink(clang::DiagnosticsEngine & InEngine, ReportWriter * const InWriter)
+    : boost::noncopyable()
+    , Engine(InEngine)
+    , Writer(InWriter)
+    , Findings()
+{
+    for (unsigned It = 0; It < KindCount; ++It) {
+        Ids[It] = Engine.getCustomDiagID(Messages[It].Level, Messages[It].Text);
+        Enabled[It] = true;
+    }
+}
+
+bool ReportSink::IsRule(llvm::StringRef const Rule) {
+    for (unsigned It = 0; It < KindCount; ++It) {
+        if ((clang::DiagnosticsEngine::Warning == Messages[It].Level) && (Rule == Messages[It].Rule)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReportSink::Select(std::vector<std::string> const & Rules) {
+    for (unsigned It = 0; It < KindCount; ++It) {
+        if (clang::DiagnosticsEngine::Warning == Messages[It].Level) {
+            Enabled[It] = (Rules.end() != std::find(Rules.begin(), Rules.end(), Messages[It].Rule));
+        }
+    }
+}
+
+clang::DiagnosticsEngine & ReportSink::GetEngine() const {
+    return Engine;
+}
+
+void ReportSink::Add(Kind const What, clang::NamedDecl const * const D) {
+    if (! Enabled[What]) {
+        return;
+    }
+    Finding const F = { D->getLocStart(), D, What };
+    Findings.push_back(F);
+}
+
+void ReportSink::Flush() {
+    clang::SourceManager const & Sources = Engine.getSourceManager();
+    std::sort(Findings.begin(), Findings.end(), IsBefore(Sources));
+    for (std::vector<Finding>::const_iterator It(Findings.begin()), End(Findings.end()); It != End; ++It) {
+        if (Writer) {
+            Message const & M = Messages[It->What];
+            clang::PresumedLoc const Loc = Sources.getPresumedLoc(It->Location);
+
+            ReportWriter::Finding F;
+            F.Rule = M.Rule;
+            F.Level = (clang::DiagnosticsEngine::Warning == M.Level) ? "warning" : "note";
+            F.Key = It->Decl->getQualifiedNameAsString();
+            F.Name = It->Decl->getNameAsString();
+            F.Message = FormatMessage(M.Text, F.Name);
+            F.File = Loc.isValid() ? Loc.getFilename() : "";
+            F.Line = Loc.isValid() ? Loc.getLine() : 0;
+            F.Column = Loc.isValid() ? Loc.getColumn() : 0;
+            Writer->Write(F);
+        } else {
+            clang::DiagnosticBuilder const DB = Engine.Report(It->Location, Ids[It->What]);
+            DB << It->Decl;
+            DB.setForceEmit();
+        }
+    }
+    Findings.clear();
+}
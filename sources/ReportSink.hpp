@@ -0,0 +1,72 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _ReportSink_hpp_
+#define _ReportSink_hpp_
+
+#include "ReportWriter.hpp"
+
+#include <string>
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/Diagnostic.h>
+
+#include <llvm/ADT/StringRef.h>
+
+#include <boost/noncopyable.hpp>
+
+// Collects the findings of an analysis and emits them in one batch, ordered
+// by their source location. The findings are kept as the declaration only,
+// the name is formatted by the diagnostic engine when it's emitted. The
+// custom diagnostic IDs are registered once, when the sink is created.
+//
+// When a writer is given, the findings are written by it instead of the
+// diagnostic engine.
+//
+// The warnings can be selected by their rule names. The debug notes are
+// emitted always.
+class ReportSink : public boost::noncopyable {
+public:
+    enum Kind
+        { VariablePseudoConstness
+        , FunctionPseudoConstness
+        , FunctionPseudoStaticness
+        , VariableDeclaration
+        , FunctionDeclaration
+        , KindCount
+        };
+
+    ReportSink(clang::DiagnosticsEngine &, ReportWriter * = 0);
+
+    // The debug reports of the scope analysis are emitted directly.
+    clang::DiagnosticsEngine & GetEngine() const;
+
+    // Is it the rule name of a warning.
+    static bool IsRule(llvm::StringRef);
+
+    // Report only the warnings of the given rules.
+    void Select(std::vector<std::string> const & Rules);
+
+    void Add(Kind, clang::NamedDecl const *);
+
+    // Emit the collected findings, and forget them.
+    void Flush();
+
+private:
+    struct Finding {
+        clang::SourceLocation Location;
+        clang::NamedDecl const * Decl;
+        Kind What;
+    };
+
+    struct IsBefore;
+
+private:
+    clang::DiagnosticsEngine & Engine;
+    ReportWriter * const Writer;
+    unsigned Ids[KindCount];
+    bool Enabled[KindCount];
+    std::vector<Finding> Findings;
+};
+
+#endif // _ReportSink_hpp_
@@ -0,0 +1,267 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "ReportWriter.hpp"
+#include "ResultFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace {
+
+void WriteString(llvm::raw_ostream & Out, llvm::StringRef const Value) {
+    Out << '"';
+    for (llvm::StringRef::const_iterator It(Value.begin()), End(Value.end()); It != End; ++It) {
+        unsigned char const C = *It;
+        switch (C) {
+        case '"' : Out << "\\\""; break;
+        case '\\' : Out << "\\\\"; break;
+        case '\n' : Out << "\\n"; break;
+        case '\r' : Out << "\\r"; break;
+        case '\t' : Out << "\\t"; break;
+        default :
+            if (C < 0x20) {
+                Out << "\\u00";
+                Out << "0123456789abcdef"[C >> 4] << "0123456789abcdef"[C & 0xf];
+            } else {
+                Out << C;
+            }
+        }
+    }
+    Out << '"';
+}
+
+// The absolute file URI of the path, the characters other than the
+// unreserved ones and the separators are percent encoded (RFC 3986).
+std::string GetFileUri(llvm::StringRef const Path) {
+    llvm::SmallString<256> Absolute(Path);
+    llvm::sys::fs::make_absolute(Absolute);
+
+    std::string Result;
+    llvm::raw_string_ostream Out(Result);
+    Out << "file://";
+    for (llvm::SmallString<256>::const_iterator It(Absolute.begin()), End(Absolute.end()); It != End; ++It) {
+        unsigned char const C = *It;
+        if ((('a' <= C) && (C <= 'z')) || (('A' <= C) && (C <= 'Z')) || (('0' <= C) && (C <= '9'))
+            || ('-' == C) || ('.' == C) || ('_' == C) || ('~' == C) || ('/' == C)) {
+            Out << C;
+        } else {
+            Out << '%' << "0123456789ABCDEF"[C >> 4] << "0123456789ABCDEF"[C & 0xf];
+        }
+    }
+    return Out.str();
+}
+
+
+class JsonLinesWriter : public ReportWriter {
+public:
+    JsonLinesWriter(int const InFile)
+        : ReportWriter()
+        , File(InFile)
+    { }
+
+    ~JsonLinesWriter() {
+        close(File);
+    }
+
+    // One line is one write, which is not interleaved with the writes of
+    // other processes appending to the same file.
+    void Write(Finding const & F) {
+        std::string Line;
+        {
+            llvm::raw_string_ostream Out(Line);
+            Out << "{\"rule\":";
+            WriteString(Out, F.Rule);
+            Out << ",\"level\":";
+            WriteString(Out, F.Level);
+            Out << ",\"name\":";
+            WriteString(Out, F.Name);
+            Out << ",\"message\":";
+            WriteString(Out, F.Message);
+            Out << ",\"file\":";
+            WriteString(Out, F.File);
+            Out << ",\"line\":" << F.Line;
+            Out << ",\"column\":" << F.Column;
+            Out << "}\n";
+        }
+        char const * Data = Line.data();
+        size_t Size = Line.size();
+        while (0 < Size) {
+            ssize_t const Written = write(File, Data, Size);
+            if (Written < 0) {
+                if (EINTR == errno)
+                    continue;
+                return;
+            }
+            Data += Written;
+            Size -= Written;
+        }
+    }
+
+private:
+    int const File;
+};
+
+
+class SarifWriter : public ReportWriter {
+public:
+    SarifWriter(int const File)
+        : ReportWriter()
+        , Out(File, true)
+        , First(true)
+    {
+        Out << "{\"version\":\"2.1.0\","
+               "\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\","
+               "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"constantine\"}},"
+               "\"results\":[\n";
+    }
+
+    ~SarifWriter() {
+        Out << "]}]}\n";
+    }
+
+    void Write(Finding const & F) {
+        Out << (First ? "" : ",\n");
+        First = false;
+
+        Out << "{\"ruleId\":";
+        WriteString(Out, F.Rule);
+        Out << ",\"level\":";
+        WriteString(Out, F.Level);
+        Out << ",\"message\":{\"text\":";
+        WriteString(Out, F.Message);
+        Out << "},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+        WriteString(Out, GetFileUri(F.File));
+        Out << "},\"region\":{\"startLine\":" << F.Line
+            << ",\"startColumn\":" << F.Column << "}}}]}";
+    }
+
+private:
+    llvm::raw_fd_ostream Out;
+    bool First;
+};
+
+
+class BinaryWriter : public ReportWriter {
+public:
+    BinaryWriter(int const File)
+        : ReportWriter()
+        , Out(File, true)
+        , Findings()
+    { }
+
+    ~BinaryWriter() {
+        std::sort(Findings.begin(), Findings.end(), &IsBefore);
+
+        StringTable Strings;
+        std::vector<ResultRecord> Records;
+        Records.reserve(Findings.size());
+        for (std::vector<Finding>::const_iterator It(Findings.begin()), End(Findings.end()); It != End; ++It) {
+            ResultRecord R;
+            R.File = Strings.Add(It->File);
+            R.Line = It->Line;
+            R.Column = It->Column;
+            R.Rule = Strings.Add(It->Rule);
+            R.Level = Strings.Add(It->Level);
+            R.Key = Strings.Add(It->Key);
+            R.Name = Strings.Add(It->Name);
+            R.Message = Strings.Add(It->Message);
+            Records.push_back(R);
+        }
+        // the table is never empty, that's how the reader can check it.
+        Strings.Add(std::string());
+
+        ResultHeader H;
+        std::memcpy(H.Magic, ResultMagic, sizeof(ResultMagic));
+        H.Version = ResultVersion;
+        H.Records = Records.size();
+        H.StringsOffset = sizeof(ResultHeader) + Records.size() * sizeof(ResultRecord);
+        H.StringsSize = Strings.Data.size();
+
+        Out.write(reinterpret_cast<char const *>(&H), sizeof(H));
+        if (! Records.empty()) {
+            Out.write(reinterpret_cast<char const *>(&Records.front()), Records.size() * sizeof(ResultRecord));
+        }
+        Out.write(Strings.Data.data(), Strings.Data.size());
+    }
+
+    void Write(Finding const & F) {
+        Findings.push_back(F);
+    }
+
+private:
+    static bool IsBefore(Finding const & Lhs, Finding const & Rhs) {
+        if (int const Result = Lhs.File.compare(Rhs.File))
+            return (Result < 0);
+        if (Lhs.Line != Rhs.Line)
+            return (Lhs.Line < Rhs.Line);
+        if (Lhs.Column != Rhs.Column)
+            return (Lhs.Column < Rhs.Column);
+        if (int const Result = std::strcmp(Lhs.Rule, Rhs.Rule))
+            return (Result < 0);
+        return (Lhs.Key < Rhs.Key);
+    }
+
+    // Each string is stored once.
+    struct StringTable {
+        uint32_t Add(std::string const & Value) {
+            std::map<std::string, uint32_t>::const_iterator const It = Offsets.find(Value);
+            if (Offsets.end() != It) {
+                return It->second;
+            }
+            uint32_t const Result = Data.size();
+            Data.append(Value.c_str(), Value.size() + 1);
+            Offsets.insert(std::make_pair(Value, Result));
+            return Result;
+        }
+
+        std::string Data;
+        std::map<std::string, uint32_t> Offsets;
+    };
+
+private:
+    llvm::raw_fd_ostream Out;
+    std::vector<Finding> Findings;
+};
+
+} // namespace anonymous
+
+
+ReportWriter::Ptr ReportWriter::Create(OutputFormat const Format, std::string const & Path, std::string & Error) {
+    int const Flags = O_WRONLY | O_CREAT | ((JsonLines == Format) ? O_APPEND : O_TRUNC);
+    int const File = open(Path.c_str(), Flags, 0666);
+    if (-1 == File) {
+        Error = std::strerror(errno);
+        return ReportWriter::Ptr();
+    }
+    switch (Format) {
+    case JsonLines :
+        return ReportWriter::Ptr( new JsonLinesWriter(File) );
+    case Sarif :
+        return ReportWriter::Ptr( new SarifWriter(File) );
+    case Binary :
+        return ReportWriter::Ptr( new BinaryWriter(File) );
+    case Diagnostics :
+        break;
+    }
+    close(File);
+    Error = "no output format";
+    return ReportWriter::Ptr();
+}
+
+ReportWriter::ReportWriter()
+    : boost::noncopyable()
+{ }
+
+ReportWriter::~ReportWriter()
+{ }
@@ -0,0 +1,48 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _ReportWriter_hpp_
+#define _ReportWriter_hpp_
+
+#include "OutputFormat.hpp"
+
+#include <memory>
+#include <string>
+
+#include <boost/noncopyable.hpp>
+
+// Writes the findings into a file in a machine readable format. Findings
+// are written as they come, the document is never built in memory.
+//
+// JSON Lines files are opened for append, and every finding is written
+// with a single system call. So parallel compilations can share one file.
+// SARIF files hold a single run, so those need a file per translation unit.
+// Binary result files (see ResultFile.hpp) are sorted, so the findings of
+// a translation unit are kept until the writer is destroyed.
+class ReportWriter : public boost::noncopyable {
+public:
+    typedef std::auto_ptr<ReportWriter> Ptr;
+
+    // Returns null pointer and sets the error message on failure.
+    static Ptr Create(OutputFormat, std::string const & Path, std::string & Error);
+
+    virtual ~ReportWriter();
+
+    struct Finding {
+        char const * Rule;
+        char const * Level;
+        std::string Message;
+        // identifies the declaration. (qualified name)
+        std::string Key;
+        std::string Name;
+        std::string File;
+        unsigned Line;
+        unsigned Column;
+    };
+
+    virtual void Write(Finding const &) = 0;
+
+protected:
+    ReportWriter();
+};
+
+#endif // _ReportWriter_hpp_
@@ -0,0 +1,97 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "ResultFile.hpp"
+
+#include <cstring>
+
+#include <llvm/Support/system_error.h>
+
+namespace {
+
+int CompareNumbers(uint32_t const Lhs, uint32_t const Rhs) {
+    return (Lhs < Rhs) ? -1 : ((Rhs < Lhs) ? 1 : 0);
+}
+
+// Every string of the records shall be in the string table.
+bool IsValid(ResultRecord const & R, uint32_t const Size) {
+    return (R.File < Size)
+        && (R.Rule < Size)
+        && (R.Level < Size)
+        && (R.Key < Size)
+        && (R.Name < Size)
+        && (R.Message < Size);
+}
+
+} // namespace anonymous
+
+
+int Compare(char const * const LhsStrings, ResultRecord const & Lhs,
+            char const * const RhsStrings, ResultRecord const & Rhs) {
+    if (int const Result = std::strcmp(LhsStrings + Lhs.File, RhsStrings + Rhs.File))
+        return Result;
+    if (int const Result = CompareNumbers(Lhs.Line, Rhs.Line))
+        return Result;
+    if (int const Result = CompareNumbers(Lhs.Column, Rhs.Column))
+        return Result;
+    if (int const Result = std::strcmp(LhsStrings + Lhs.Rule, RhsStrings + Rhs.Rule))
+        return Result;
+    return std::strcmp(LhsStrings + Lhs.Key, RhsStrings + Rhs.Key);
+}
+
+
+ResultFile * ResultFile::Open(std::string const & Path, std::string & Error) {
+    llvm::OwningPtr<llvm::MemoryBuffer> Buffer;
+    if (llvm::error_code const Code = llvm::MemoryBuffer::getFile(Path, Buffer, -1, false)) {
+        Error = Code.message();
+        return 0;
+    }
+    size_t const Size = Buffer->getBufferSize();
+    ResultHeader const * const Header =
+        reinterpret_cast<ResultHeader const *>(Buffer->getBufferStart());
+    if ((Size < sizeof(ResultHeader)) ||
+        (0 != std::memcmp(Header->Magic, ResultMagic, sizeof(ResultMagic))) ||
+        (ResultVersion != Header->Version)
+    ) {
+        Error = "not a result file";
+        return 0;
+    }
+    uint64_t const RecordsEnd =
+        sizeof(ResultHeader) + uint64_t(Header->Records) * sizeof(ResultRecord);
+    uint64_t const StringsEnd =
+        uint64_t(Header->StringsOffset) + Header->StringsSize;
+    if ((RecordsEnd > Header->StringsOffset) ||
+        (StringsEnd != Size) ||
+        (0 == Header->StringsSize) ||
+        ('\0' != Buffer->getBufferStart()[Size - 1])
+    ) {
+        Error = "corrupted result file";
+        return 0;
+    }
+    ResultRecord const * const Records =
+        reinterpret_cast<ResultRecord const *>(Header + 1);
+    for (uint32_t It = 0; It < Header->Records; ++It) {
+        if (! IsValid(Records[It], Header->StringsSize)) {
+            Error = "corrupted result file";
+            return 0;
+        }
+    }
+    return new ResultFile(Buffer.take());
+}
+
+ResultFile::ResultFile(llvm::MemoryBuffer * const InBuffer)
+    : boost::noncopyable()
+    , Buffer(InBuffer)
+    , Header(reinterpret_cast<ResultHeader const *>(InBuffer->getBufferStart()))
+{ }
+
+unsigned ResultFile::GetSize() const {
+    return Header->Records;
+}
+
+ResultRecord const & ResultFile::GetRecord(unsigned const Index) const {
+    return reinterpret_cast<ResultRecord const *>(Header + 1)[Index];
+}
+
+char const * ResultFile::GetStrings() const {
+    return Buffer->getBufferStart() + Header->StringsOffset;
+}
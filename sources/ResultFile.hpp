@@ -0,0 +1,68 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _ResultFile_hpp_
+#define _ResultFile_hpp_
+
+#include <string>
+
+#include <stdint.h>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <boost/noncopyable.hpp>
+
+// The binary result file of a translation unit. (Native byte order.)
+//
+//     ResultHeader
+//     ResultRecord * Records
+//     string table (null terminated strings)
+//
+// Strings are referred by their offset in the string table. The records
+// are sorted by file, line, column, rule and key, so result files can be
+// merged without reading them into memory.
+struct ResultHeader {
+    char Magic[4];
+    uint32_t Version;
+    uint32_t Records;
+    uint32_t StringsOffset;
+    uint32_t StringsSize;
+};
+
+struct ResultRecord {
+    uint32_t File;
+    uint32_t Line;
+    uint32_t Column;
+    uint32_t Rule;
+    uint32_t Level;
+    uint32_t Key;
+    uint32_t Name;
+    uint32_t Message;
+};
+
+char const ResultMagic[4] = { 'C', 'N', 'S', 'T' };
+uint32_t const ResultVersion = 1;
+
+// Compare records by their sort order.
+int Compare(char const * LhsStrings, ResultRecord const & Lhs,
+            char const * RhsStrings, ResultRecord const & Rhs);
+
+// Read only view of a result file. The file is mapped into memory.
+class ResultFile : public boost::noncopyable {
+public:
+    // Returns null pointer and sets the error message on failure.
+    static ResultFile * Open(std::string const & Path, std::string & Error);
+
+    unsigned GetSize() const;
+    ResultRecord const & GetRecord(unsigned) const;
+    char const * GetStrings() const;
+
+private:
+    ResultFile(llvm::MemoryBuffer *);
+
+private:
+    llvm::OwningPtr<llvm::MemoryBuffer> const Buffer;
+    ResultHeader const * const Header;
+};
+
+#endif // _ResultFile_hpp_
@@ -1,22 +1,29 @@
 // This file is distributed under MIT-LICENSE. See COPYING for details.
 
+#define DEBUG_TYPE "constantine"
+
 #include "ScopeAnalysis.hpp"
 #include "UsageCollector.hpp"
-#include "IsCXXThisExpr.hpp"
+#include "DeclarationCollector.hpp"
+#include "Statistics.hpp"
 
 #include <clang/AST/RecursiveASTVisitor.h>
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
+
+STATISTIC(NumScopes, "Number of scopes traversed");
+
 namespace {
 
 // Collect all variables which were mutated in the given scope.
-// (The scope is given by the TraverseStmt method.)
+// (The visitor methods are called by the ScopeCollector.)
 class VariableChangeCollector
-    : public UsageCollector
-    , public clang::RecursiveASTVisitor<VariableChangeCollector> {
+    : public UsageCollector {
 public:
-    VariableChangeCollector(ScopeAnalysis::UsageRefsMap & Out)
-        : UsageCollector(Out)
-        , clang::RecursiveASTVisitor<VariableChangeCollector>()
+    VariableChangeCollector(ScopeAnalysis::UsageRefsMap & Out, llvm::BumpPtrAllocator & Arena, Variables const * const Tracked)
+        : UsageCollector(Out, Arena, Tracked)
     { }
 
 public:
@@ -123,22 +130,16 @@ private:
             (Stmt->getDirectCallee()) &&
             (clang::dyn_cast<clang::CXXMethodDecl const>(Stmt->getDirectCallee()));
     }
-
-public:
-    void Report(clang::DiagnosticsEngine & DE) const {
-        UsageCollector::Report("variable '%0' with type '%1' was changed", DE);
-    }
 };
 
 // Collect all variables which were accessed in the given scope.
-// (The scope is given by the TraverseStmt method.)
+// (The visitor methods are called by the ScopeCollector.)
 class VariableAccessCollector
-    : public UsageCollector
-    , public clang::RecursiveASTVisitor<VariableAccessCollector> {
+    : public UsageCollector {
 public:
-    VariableAccessCollector(ScopeAnalysis::UsageRefsMap & Out)
-        : UsageCollector(Out)
-        , clang::RecursiveASTVisitor<VariableAccessCollector>()
+    VariableAccessCollector(ScopeAnalysis::UsageRefsMap & Out, llvm::BumpPtrAllocator & Arena, Variables const * const Tracked)
+        : UsageCollector(Out, Arena, Tracked)
+        , RootedAtThis()
     { }
 
 public:
@@ -148,53 +149,171 @@ public:
     }
 
     bool VisitMemberExpr(clang::MemberExpr * const Stmt) {
-        if (IsCXXThisExpr::Check(Stmt)) {
+        if (IsRootedAtThis(Stmt)) {
             AddToResults(Stmt);
         }
         return true;
     }
 
+private:
+    // Decide the member access is made on 'this' or not. The objects of
+    // member calls and member operator calls (smart pointers, subscripts)
+    // are followed. The outer member expressions are visited first, and the
+    // decision is cached for every member expression on the way. So the
+    // inner ones are not walked again.
+    bool IsRootedAtThis(clang::MemberExpr const * const Stmt) {
+        llvm::SmallVector<clang::MemberExpr const *, 8> Chain;
+        bool Result = false;
+
+        clang::Expr const * E = Stmt;
+        while (E) {
+            if (clang::MemberExpr const * const ME = clang::dyn_cast<clang::MemberExpr const>(E)) {
+                llvm::DenseMap<clang::MemberExpr const *, bool>::const_iterator const It =
+                    RootedAtThis.find(ME);
+                if (RootedAtThis.end() != It) {
+                    Result = It->second;
+                    break;
+                }
+                Chain.push_back(ME);
+                E = ME->getBase();
+                continue;
+            }
+            if (clang::dyn_cast<clang::CXXThisExpr const>(E)) {
+                Result = true;
+                break;
+            }
+            if (clang::CXXMemberCallExpr const * const MCE = clang::dyn_cast<clang::CXXMemberCallExpr const>(E)) {
+                E = MCE->getImplicitObjectArgument();
+                continue;
+            }
+            if (clang::CXXOperatorCallExpr const * const OCE = clang::dyn_cast<clang::CXXOperatorCallExpr const>(E)) {
+                E = GetObjectArgument(OCE);
+                continue;
+            }
+            E = StripOnce(E);
+        }
+        for (llvm::SmallVector<clang::MemberExpr const *, 8>::const_iterator It(Chain.begin()), End(Chain.end()); It != End; ++It) {
+            RootedAtThis[*It] = Result;
+        }
+        return Result;
+    }
+
+private:
+    llvm::DenseMap<clang::MemberExpr const *, bool> RootedAtThis;
+};
+
+// Collect the mutated and the accessed variables in one traversal of the
+// given scope. (The scope is given by the TraverseStmt method.)
+class ScopeCollector
+    : public boost::noncopyable
+    , public clang::RecursiveASTVisitor<ScopeCollector> {
 public:
-    void Report(clang::DiagnosticsEngine & DE) const {
-        UsageCollector::Report("symbol '%0' was used", DE);
+    ScopeCollector(ScopeAnalysis::UsageRefsMap & Changed,
+                   ScopeAnalysis::UsageRefsMap & Used,
+                   bool & InThisReferenced,
+                   llvm::BumpPtrAllocator & Arena,
+                   Variables const * const Tracked)
+        : boost::noncopyable()
+        , clang::RecursiveASTVisitor<ScopeCollector>()
+        , Changes(Changed, Arena, Tracked)
+        , Accesses(Used, Arena, Tracked)
+        , ThisReferenced(InThisReferenced)
+    { }
+
+public:
+    // public visitor methods, dispatched to the collectors.
+    bool VisitBinaryOperator(clang::BinaryOperator const * const Stmt) {
+        return Changes.VisitBinaryOperator(Stmt);
     }
+
+    bool VisitUnaryOperator(clang::UnaryOperator const * const Stmt) {
+        return Changes.VisitUnaryOperator(Stmt);
+    }
+
+    bool VisitCXXConstructExpr(clang::CXXConstructExpr const * const Stmt) {
+        return Changes.VisitCXXConstructExpr(Stmt);
+    }
+
+    bool VisitCallExpr(clang::CallExpr const * const Stmt) {
+        return Changes.VisitCallExpr(Stmt);
+    }
+
+    bool VisitCXXMemberCallExpr(clang::CXXMemberCallExpr const * const Stmt) {
+        return Changes.VisitCXXMemberCallExpr(Stmt);
+    }
+
+    bool VisitCXXOperatorCallExpr(clang::CXXOperatorCallExpr const * const Stmt) {
+        return Changes.VisitCXXOperatorCallExpr(Stmt);
+    }
+
+    bool VisitCXXNewExpr(clang::CXXNewExpr const * const Stmt) {
+        return Changes.VisitCXXNewExpr(Stmt);
+    }
+
+    bool VisitDeclRefExpr(clang::DeclRefExpr const * const Stmt) {
+        return Accesses.VisitDeclRefExpr(Stmt);
+    }
+
+    bool VisitMemberExpr(clang::MemberExpr * const Stmt) {
+        return Accesses.VisitMemberExpr(Stmt);
+    }
+
+    bool VisitCXXThisExpr(clang::CXXThisExpr const *) {
+        ThisReferenced = true;
+        return true;
+    }
+
+private:
+    VariableChangeCollector Changes;
+    VariableAccessCollector Accesses;
+    bool & ThisReferenced;
 };
 
 } // namespace anonymous
 
-ScopeAnalysis ScopeAnalysis::AnalyseThis(clang::Stmt const & Stmt) {
+ScopeAnalysis ScopeAnalysis::AnalyseThis(clang::Stmt const & Stmt, llvm::BumpPtrAllocator & Arena, Variables const * const Tracked) {
+    PhaseTimer const Timer(ScopeAnalysisPhase);
+    ++NumScopes;
     ScopeAnalysis Result;
     {
-        VariableChangeCollector Visitor(Result.Changed);
-        Visitor.TraverseStmt(const_cast<clang::Stmt*>(&Stmt));
-    }
-    {
-        VariableAccessCollector Visitor(Result.Used);
+        ScopeCollector Visitor(Result.Changed, Result.Used, Result.ThisReferenced, Arena, Tracked);
         Visitor.TraverseStmt(const_cast<clang::Stmt*>(&Stmt));
     }
     return Result;
 }
 
 bool ScopeAnalysis::WasChanged(clang::DeclaratorDecl const * const Decl) const {
-    return (Changed.end() != Changed.find(Decl));
+    return Changed.count(Decl);
 }
 
 bool ScopeAnalysis::WasReferenced(clang::DeclaratorDecl const * const Decl) const {
-    return (Used.end() != Used.find(Decl));
+    return Used.count(Decl);
 }
 
-void ScopeAnalysis::DebugChanged(clang::DiagnosticsEngine & DE) const {
-    ScopeAnalysis Copy = *this;
-    {
-        VariableChangeCollector const Visitor(Copy.Changed);
-        Visitor.Report(DE);
-    }
+bool ScopeAnalysis::WasThisReferenced() const {
+    return ThisReferenced;
 }
 
-void ScopeAnalysis::DebugReferenced(clang::DiagnosticsEngine & DE) const {
-    ScopeAnalysis Copy = *this;
-    {
-        VariableAccessCollector const Visitor(Copy.Used);
-        Visitor.Report(DE);
+ScopeSummary ScopeAnalysis::Summarize() const {
+    ScopeSummary Result;
+    for (UsageRefsMap::const_iterator It(Changed.begin()), End(Changed.end()); It != End; ++It) {
+        Result.Changed.insert(It->first);
     }
+    for (UsageRefsMap::const_iterator It(Used.begin()), End(Used.end()); It != End; ++It) {
+        Result.Referenced.insert(It->first);
+    }
+    Result.ThisReferenced = ThisReferenced;
+    return Result;
+}
+
+std::size_t ScopeAnalysis::GetMemorySize() const {
+    return Changed.getMemorySize() + Used.getMemorySize();
+}
+
+void ScopeAnalysis::DebugChanged(clang::DiagnosticsEngine & DE, AnalysedFiles & Files) const {
+    UsageCollector::Report(Changed, "variable '%0' with type '%1' was changed", DE, Files);
+}
+
+void ScopeAnalysis::DebugReferenced(clang::DiagnosticsEngine & DE, AnalysedFiles & Files) const {
+    UsageCollector::Report(Used, "symbol '%0' was used", DE, Files);
 }
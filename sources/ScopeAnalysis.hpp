@@ -3,34 +3,98 @@
 #ifndef _ScopeAnalysis_hpp_
 #define _ScopeAnalysis_hpp_
 
+#include "DeclarationCollector.hpp"
+
+#include <cstddef>
 #include <utility>
-#include <list>
-#include <map>
 
 #include <clang/AST/AST.h>
 #include <clang/Basic/Diagnostic.h>
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/Allocator.h>
+
+
+// The answers of a scope analysis without the usage locations. This is
+// what the pseudo constness analysis needs from a function body, and this
+// is what the analysis cache stores for a function.
+struct ScopeSummary {
+    ScopeSummary()
+        : Changed()
+        , Referenced()
+        , ThisReferenced(false)
+    { }
+
+    bool WasChanged(clang::DeclaratorDecl const * const D) const {
+        return Changed.count(D);
+    }
+    bool WasReferenced(clang::DeclaratorDecl const * const D) const {
+        return Referenced.count(D);
+    }
+    bool WasThisReferenced() const {
+        return ThisReferenced;
+    }
+
+    Variables Changed;
+    Variables Referenced;
+    bool ThisReferenced;
+};
+
+class AnalysedFiles;
 
 // This class tracks the usage of variables in a statement body to see
 // if they are never written to, implying that they constant.
 class ScopeAnalysis {
 public:
     typedef std::pair<clang::QualType, clang::SourceRange> UsageRef;
-    typedef std::list<UsageRef> UsageRefs;
-    typedef std::map<clang::DeclaratorDecl const *, UsageRefs> UsageRefsMap;
+
+    // The usages of a variable are kept in a singly linked list, in the
+    // order of the appearance. The nodes are allocated from the arena of
+    // the translation unit and never released one by one.
+    struct UsageRefNode {
+        UsageRefNode(UsageRef const & InRef)
+            : Ref(InRef)
+            , Next(0)
+        { }
+
+        UsageRef const Ref;
+        UsageRefNode * Next;
+    };
+    struct UsageRefs {
+        UsageRefNode * First;
+        UsageRefNode * Last;
+    };
+    typedef llvm::DenseMap<clang::DeclaratorDecl const *, UsageRefs> UsageRefsMap;
 
 public:
-    static ScopeAnalysis AnalyseThis(clang::Stmt const &);
+    // When the tracked variables are given, the usages of other variables
+    // are not recorded. (Members and methods are recorded always.)
+    static ScopeAnalysis AnalyseThis(clang::Stmt const &, llvm::BumpPtrAllocator &, Variables const * Tracked = 0);
 
     bool WasChanged(clang::DeclaratorDecl const *) const;
     bool WasReferenced(clang::DeclaratorDecl const *) const;
+    bool WasThisReferenced() const;
+
+    ScopeSummary Summarize() const;
 
-    void DebugChanged(clang::DiagnosticsEngine &) const;
-    void DebugReferenced(clang::DiagnosticsEngine &) const;
+    // The size of the usage maps. (The usage nodes are in the arena.)
+    std::size_t GetMemorySize() const;
+
+    // Only the declarations of the analysed files are reported.
+    void DebugChanged(clang::DiagnosticsEngine &, AnalysedFiles &) const;
+    void DebugReferenced(clang::DiagnosticsEngine &, AnalysedFiles &) const;
+
+private:
+    ScopeAnalysis()
+        : Changed()
+        , Used()
+        , ThisReferenced(false)
+    { }
 
 private:
     UsageRefsMap Changed;
     UsageRefsMap Used;
+    bool ThisReferenced;
 };
 
 #endif // _ScopeAnalysis_hpp_
@@ -0,0 +1,92 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "SourceFilter.hpp"
+
+#include <clang/Basic/FileManager.h>
+
+namespace {
+
+void Compile(std::vector<std::string> const & In, boost::ptr_vector<llvm::Regex> & Out) {
+    for (std::vector<std::string>::const_iterator It(In.begin()), End(In.end()); It != End; ++It) {
+        Out.push_back(new llvm::Regex(*It));
+    }
+}
+
+bool AreValid(boost::ptr_vector<llvm::Regex> & Ps, std::string & Error) {
+    for (boost::ptr_vector<llvm::Regex>::iterator It(Ps.begin()), End(Ps.end()); It != End; ++It) {
+        if (! It->isValid(Error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace anonymous
+
+
+SourceFilter::SourceFilter(std::vector<std::string> const & InIncludes,
+                           std::vector<std::string> const & InExcludes,
+                           bool const InWithSystemHeaders)
+    : boost::noncopyable()
+    , Includes()
+    , Excludes()
+    , WithSystemHeaders(InWithSystemHeaders)
+{
+    Compile(InIncludes, Includes);
+    Compile(InExcludes, Excludes);
+}
+
+bool SourceFilter::IsValid(std::string & Error) {
+    return AreValid(Includes, Error) && AreValid(Excludes, Error);
+}
+
+bool SourceFilter::IsMatching(Patterns & Ps, llvm::StringRef const Path) {
+    for (Patterns::iterator It(Ps.begin()), End(Ps.end()); It != End; ++It) {
+        if (It->match(Path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SourceFilter::IsAnalysed(clang::SourceManager const & SM, clang::FileID const File) {
+    clang::FileEntry const * const Entry = SM.getFileEntryForID(File);
+    if (! Entry) {
+        return false;
+    }
+    if (IsMatching(Excludes, Entry->getName())) {
+        return false;
+    }
+    if (SM.getMainFileID() == File) {
+        return true;
+    }
+    if ((! WithSystemHeaders) && SM.isInSystemHeader(SM.getLocForStartOfFile(File))) {
+        return false;
+    }
+    return IsMatching(Includes, Entry->getName());
+}
+
+
+AnalysedFiles::AnalysedFiles(SourceFilter & InFilter, clang::SourceManager const & InSources)
+    : boost::noncopyable()
+    , Filter(InFilter)
+    , Sources(InSources)
+    , Decisions()
+{ }
+
+bool AnalysedFiles::Contains(clang::Decl const * const D) {
+    clang::FileID const File =
+        Sources.getFileID(Sources.getExpansionLoc(D->getLocation()));
+    if (File.isInvalid()) {
+        return false;
+    }
+    {
+        llvm::DenseMap<clang::FileID, bool>::const_iterator const It = Decisions.find(File);
+        if (Decisions.end() != It) {
+            return It->second;
+        }
+    }
+    bool const Result = Filter.IsAnalysed(Sources, File);
+    Decisions[File] = Result;
+    return Result;
+}
@@ -0,0 +1,60 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _SourceFilter_hpp_
+#define _SourceFilter_hpp_
+
+#include <string>
+#include <vector>
+
+#include <clang/AST/AST.h>
+#include <clang/Basic/SourceManager.h>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/Support/Regex.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+// Decide which source files are analysed. The main file is analysed by
+// default. Other files are analysed when their path matches one of the
+// include patterns. Files which path matches one of the exclude patterns
+// are never analysed. System headers are skipped, unless it was asked.
+//
+// The patterns are compiled once, when the filter is constructed. (The
+// matching of a compiled pattern changes its state.)
+class SourceFilter : public boost::noncopyable {
+public:
+    SourceFilter(std::vector<std::string> const & Includes,
+                 std::vector<std::string> const & Excludes,
+                 bool WithSystemHeaders);
+
+    bool IsValid(std::string & Error);
+
+    bool IsAnalysed(clang::SourceManager const &, clang::FileID);
+
+private:
+    typedef boost::ptr_vector<llvm::Regex> Patterns;
+
+    static bool IsMatching(Patterns &, llvm::StringRef);
+
+private:
+    Patterns Includes;
+    Patterns Excludes;
+    bool const WithSystemHeaders;
+};
+
+// Remember the decisions of the filter for the files of one translation
+// unit, so the patterns are matched only once per file.
+class AnalysedFiles : public boost::noncopyable {
+public:
+    AnalysedFiles(SourceFilter &, clang::SourceManager const &);
+
+    bool Contains(clang::Decl const *);
+
+private:
+    SourceFilter & Filter;
+    clang::SourceManager const & Sources;
+    llvm::DenseMap<clang::FileID, bool> Decisions;
+};
+
+#endif // _SourceFilter_hpp_
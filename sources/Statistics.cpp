@@ -0,0 +1,79 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "Statistics.hpp"
+
+#include <pthread.h>
+
+#include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/Timer.h>
+
+namespace {
+
+char const * const PhaseNames[PhaseCount] =
+    { "Declaration collection"
+    , "Scope analysis"
+    , "Reference tracking"
+    , "Reporting"
+    };
+
+struct Timers {
+    Timers()
+        : Group("Constantine")
+    {
+        for (unsigned It = 0; It < PhaseCount; ++It) {
+            Phases[It].init(PhaseNames[It], Group);
+        }
+    }
+
+    // the timers are removed from the group before it's destroyed.
+    llvm::TimerGroup Group;
+    llvm::Timer Phases[PhaseCount];
+};
+
+llvm::ManagedStatic<Timers> AllTimers;
+
+bool Enabled = false;
+pthread_t Owner;
+// the running phase of the owner thread.
+int Current = -1;
+
+bool IsActive(Phase const P) {
+    return Enabled
+        && pthread_equal(Owner, pthread_self())
+        && (int(P) != Current);
+}
+
+} // namespace anonymous
+
+
+void EnableTimers() {
+    Owner = pthread_self();
+    Enabled = true;
+}
+
+PhaseTimer::PhaseTimer(Phase const P)
+    : boost::noncopyable()
+    , Active(IsActive(P))
+    // the other threads do not touch the phase of the owner thread.
+    , Outer(Active ? Current : -1)
+{
+    if (! Active) {
+        return;
+    }
+    if (0 <= Outer) {
+        AllTimers->Phases[Outer].stopTimer();
+    }
+    AllTimers->Phases[P].startTimer();
+    Current = P;
+}
+
+PhaseTimer::~PhaseTimer() {
+    if (! Active) {
+        return;
+    }
+    AllTimers->Phases[Current].stopTimer();
+    if (0 <= Outer) {
+        AllTimers->Phases[Outer].startTimer();
+    }
+    Current = Outer;
+}
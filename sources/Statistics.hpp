@@ -0,0 +1,36 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _Statistics_hpp_
+#define _Statistics_hpp_
+
+#include <boost/noncopyable.hpp>
+
+// The phases of the analysis, which are timed separately.
+enum Phase
+    { DeclarationCollection
+    , ScopeAnalysisPhase
+    , ReferenceTracking
+    , Reporting
+    , PhaseCount
+    };
+
+// Start the timers of the analysis phases. The timers are printed with the
+// other timers of the compiler (-ftime-report), or at the exit.
+//
+// The timers are not thread safe, only the phases of the thread which
+// enabled them are timed.
+void EnableTimers();
+
+// Times the given phase while it's in scope. The time of a nested phase is
+// not counted to the enclosing phase.
+class PhaseTimer : public boost::noncopyable {
+public:
+    PhaseTimer(Phase);
+    ~PhaseTimer();
+
+private:
+    bool const Active;
+    int const Outer;
+};
+
+#endif // _Statistics_hpp_
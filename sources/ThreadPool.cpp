@@ -0,0 +1,117 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <pthread.h>
+
+namespace {
+
+// The not yet executed tasks of a thread. [Begin, End)
+struct Queue {
+    pthread_mutex_t Lock;
+    unsigned Begin;
+    unsigned End;
+};
+
+struct Context {
+    ThreadPool::Work * Work;
+    std::vector<Queue> Queues;
+};
+
+struct Worker {
+    Context * Ctx;
+    unsigned Index;
+};
+
+bool Pop(Queue & Q, unsigned & Task) {
+    pthread_mutex_lock(&Q.Lock);
+    bool const Result = (Q.Begin < Q.End);
+    if (Result) {
+        Task = Q.Begin++;
+    }
+    pthread_mutex_unlock(&Q.Lock);
+    return Result;
+}
+
+bool Steal(Context & Ctx, unsigned const Thief, unsigned & Task) {
+    unsigned const Threads = Ctx.Queues.size();
+    for (unsigned It = 1; It < Threads; ++It) {
+        Queue & Victim = Ctx.Queues[(Thief + It) % Threads];
+
+        pthread_mutex_lock(&Victim.Lock);
+        unsigned const Left = (Victim.Begin < Victim.End) ? (Victim.End - Victim.Begin) : 0;
+        unsigned const Half = (Left + 1) / 2;
+        unsigned const First = Victim.End - Half;
+        Victim.End = First;
+        pthread_mutex_unlock(&Victim.Lock);
+
+        if (Half) {
+            Queue & Own = Ctx.Queues[Thief];
+            pthread_mutex_lock(&Own.Lock);
+            Own.Begin = First + 1;
+            Own.End = First + Half;
+            pthread_mutex_unlock(&Own.Lock);
+
+            Task = First;
+            return true;
+        }
+    }
+    return false;
+}
+
+void * Execute(void * const Arg) {
+    Worker const & W = *(static_cast<Worker *>(Arg));
+    Context & Ctx = *(W.Ctx);
+
+    unsigned Task = 0;
+    while (Pop(Ctx.Queues[W.Index], Task) || Steal(Ctx, W.Index, Task)) {
+        Ctx.Work->Run(W.Index, Task);
+    }
+    return 0;
+}
+
+} // namespace anonymous
+
+
+ThreadPool::Work::~Work()
+{ }
+
+void ThreadPool::Run(Work & Work, unsigned const InThreads, unsigned const Tasks) {
+    unsigned const Threads = (0 == InThreads) ? 1 : InThreads;
+
+    Context Ctx;
+    Ctx.Work = &Work;
+    Ctx.Queues.resize(Threads);
+    for (unsigned It = 0; It < Threads; ++It) {
+        Queue & Q = Ctx.Queues[It];
+        pthread_mutex_init(&Q.Lock, 0);
+        Q.Begin = (Tasks / Threads) * It + std::min(It, Tasks % Threads);
+        Q.End = Q.Begin + (Tasks / Threads) + ((It < (Tasks % Threads)) ? 1 : 0);
+    }
+
+    std::vector<Worker> Workers(Threads);
+    std::vector<pthread_t> Handles(Threads);
+    std::vector<bool> Started(Threads, false);
+    for (unsigned It = 0; It < Threads; ++It) {
+        Workers[It].Ctx = &Ctx;
+        Workers[It].Index = It;
+    }
+    // the calling thread is the first worker. when a thread can not be
+    // started, its tasks are stolen by the others.
+    for (unsigned It = 1; It < Threads; ++It) {
+        Started[It] = (0 == pthread_create(&Handles[It], 0, Execute, &Workers[It]));
+    }
+    Execute(&Workers[0]);
+    for (unsigned It = 1; It < Threads; ++It) {
+        if (Started[It]) {
+            pthread_join(Handles[It], 0);
+        }
+    }
+
+    for (unsigned It = 0; It < Threads; ++It) {
+        pthread_mutex_destroy(&Ctx.Queues[It].Lock);
+    }
+}
@@ -0,0 +1,26 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#ifndef _ThreadPool_hpp_
+#define _ThreadPool_hpp_
+
+#include <boost/noncopyable.hpp>
+
+// Runs a known number of tasks on a fixed number of threads. Every thread
+// starts with a continuous range of the tasks. A thread which was run out
+// of its own tasks steals the second half of the range of an other thread.
+// The call returns when all tasks were executed.
+class ThreadPool : public boost::noncopyable {
+public:
+    // The work to execute. The thread index is passed with the task index,
+    // so the work can keep per thread state without locking.
+    class Work {
+    public:
+        virtual ~Work();
+
+        virtual void Run(unsigned Thread, unsigned Task) = 0;
+    };
+
+    static void Run(Work &, unsigned Threads, unsigned Tasks);
+};
+
+#endif // _ThreadPool_hpp_
@@ -0,0 +1,363 @@
+// This file is distributed under MIT-LICENSE. See COPYING for details.
+
+#include "ModuleAnalysis.hpp"
+#include "ReportSink.hpp"
+#include "SourceFilter.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <clang/Basic/Diagnostic.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendAction.h>
+#include <clang/Tooling/CompilationDatabase.h>
+#include <clang/Tooling/Tooling.h>
+
+#include <boost/noncopyable.hpp>
+
+
+namespace {
+
+llvm::cl::opt<std::string>
+    BuildPath("p",
+        llvm::cl::desc("Build directory, which contains the compile_commands.json"),
+        llvm::cl::Required);
+llvm::cl::list<std::string>
+    SourcePaths(llvm::cl::Positional,
+        llvm::cl::desc("<source> ... (all sources of the database by default)"),
+        llvm::cl::ZeroOrMore);
+llvm::cl::opt<unsigned>
+    Jobs("j",
+        llvm::cl::desc("Number of translation units analysed in parallel (number of processors by default)"),
+        llvm::cl::init(0));
+llvm::cl::list<std::string>
+    Includes("constantine-include",
+        llvm::cl::desc("Analyse files which path matches the given regex"),
+        llvm::cl::ZeroOrMore);
+llvm::cl::list<std::string>
+    Excludes("constantine-exclude",
+        llvm::cl::desc("Skip files which path matches the given regex"),
+        llvm::cl::ZeroOrMore);
+llvm::cl::opt<bool>
+    SystemHeaders("constantine-system-headers",
+        llvm::cl::desc("Analyse system headers which match the include patterns"),
+        llvm::cl::init(false));
+llvm::cl::opt<std::string>
+    CacheDirectory("constantine-cache",
+        llvm::cl::desc("Keep the analysis of functions in the given directory"),
+        llvm::cl::init(""));
+llvm::cl::opt<bool>
+    Instantiations("constantine-instantiations",
+        llvm::cl::desc("Analyse the template instantiations too"),
+        llvm::cl::init(false));
+llvm::cl::list<std::string>
+    Checks("constantine-checks",
+        llvm::cl::desc("Report only the warnings of the given rules"),
+        llvm::cl::CommaSeparated);
+llvm::cl::opt<bool>
+    Streaming("constantine-streaming",
+        llvm::cl::desc("Analyse the top level declarations while the translation unit is parsed"),
+        llvm::cl::init(false));
+
+
+// One diagnostic of a translation unit. The findings of the translation
+// units are merged by these, so a header finding is reported only once.
+struct Finding {
+    std::string File;
+    unsigned Line;
+    unsigned Column;
+    std::string Level;
+    std::string Message;
+
+    bool operator<(Finding const & Other) const {
+        if (File != Other.File)
+            return File < Other.File;
+        if (Line != Other.Line)
+            return Line < Other.Line;
+        if (Column != Other.Column)
+            return Column < Other.Column;
+        if (Level != Other.Level)
+            return Level < Other.Level;
+        return Message < Other.Message;
+    }
+};
+
+char const * GetLevelName(clang::DiagnosticsEngine::Level const Level) {
+    switch (Level) {
+    case clang::DiagnosticsEngine::Note :
+        return "note";
+    case clang::DiagnosticsEngine::Warning :
+        return "warning";
+    case clang::DiagnosticsEngine::Error :
+    case clang::DiagnosticsEngine::Fatal :
+        return "error";
+    default :
+        return "ignored";
+    }
+}
+
+// Writes the diagnostics of a translation unit as tab separated lines.
+// (The messages of the analysis does not contain tab or new line.)
+class FindingWriter : public clang::DiagnosticConsumer {
+public:
+    FindingWriter(llvm::raw_ostream & InOut)
+        : clang::DiagnosticConsumer()
+        , Out(InOut)
+    { }
+
+    void HandleDiagnostic(clang::DiagnosticsEngine::Level Level, clang::Diagnostic const & Info) {
+        clang::DiagnosticConsumer::HandleDiagnostic(Level, Info);
+
+        llvm::SmallString<128> Message;
+        Info.FormatDiagnostic(Message);
+
+        std::string File = "<unknown>";
+        unsigned Line = 0;
+        unsigned Column = 0;
+        if (Info.getLocation().isValid() && Info.hasSourceManager()) {
+            clang::PresumedLoc const Loc =
+                Info.getSourceManager().getPresumedLoc(Info.getLocation());
+            if (Loc.isValid()) {
+                File = Loc.getFilename();
+                Line = Loc.getLine();
+                Column = Loc.getColumn();
+            }
+        }
+        Out << File << '\t' << Line << '\t' << Column << '\t'
+            << GetLevelName(Level) << '\t' << Message.str() << '\n';
+    }
+
+    clang::DiagnosticConsumer * clone(clang::DiagnosticsEngine &) const {
+        return new FindingWriter(Out);
+    }
+
+private:
+    llvm::raw_ostream & Out;
+};
+
+// The analysis as a frontend action. The diagnostics of the compiler are
+// captured, instead of printing them.
+class AnalysisAction : public clang::ASTFrontendAction {
+public:
+    AnalysisAction(Options const & InSettings, llvm::raw_ostream & InOut)
+        : clang::ASTFrontendAction()
+        , Settings(InSettings)
+        , Out(InOut)
+    { }
+
+private:
+    clang::ASTConsumer * CreateASTConsumer(clang::CompilerInstance & Compiler, llvm::StringRef) {
+        Compiler.getDiagnostics().setClient(new FindingWriter(Out), true);
+        return new ModuleAnalysis(Compiler, Settings);
+    }
+
+private:
+    Options const & Settings;
+    llvm::raw_ostream & Out;
+};
+
+class AnalysisActionFactory : public clang::tooling::FrontendActionFactory {
+public:
+    AnalysisActionFactory(Options const & InSettings, llvm::raw_ostream & InOut)
+        : clang::tooling::FrontendActionFactory()
+        , Settings(InSettings)
+        , Out(InOut)
+    { }
+
+    clang::FrontendAction * create() {
+        return new AnalysisAction(Settings, Out);
+    }
+
+private:
+    Options const & Settings;
+    llvm::raw_ostream & Out;
+};
+
+
+// The analysis of the translation units run in worker processes, because
+// the compiler has global state. The workers take the next not analysed
+// file from a shared counter, so a slow file does not hold back the rest.
+// Every worker writes its findings into its own temporary file.
+class Workers : public boost::noncopyable {
+public:
+    Workers(clang::tooling::CompilationDatabase const & InCompilations,
+            std::vector<std::string> const & InFiles,
+            Options const & InSettings)
+        : boost::noncopyable()
+        , Compilations(InCompilations)
+        , Files(InFiles)
+        , Settings(InSettings)
+    { }
+
+    bool Run(unsigned const Count, std::set<Finding> & Result) const {
+        unsigned * const Next = static_cast<unsigned *>(
+            mmap(0, sizeof(unsigned), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+        if (MAP_FAILED == Next) {
+            llvm::errs() << "constantine: can't create shared memory\n";
+            return false;
+        }
+        *Next = 0;
+
+        bool Success = true;
+        std::vector<std::FILE *> Outputs;
+        std::vector<pid_t> Children;
+        for (unsigned It = 0; It < Count; ++It) {
+            std::FILE * const Output = std::tmpfile();
+            if (! Output) {
+                Success = false;
+                break;
+            }
+            Outputs.push_back(Output);
+            pid_t const Child = fork();
+            if (0 == Child) {
+                std::_Exit(Execute(*Next, fileno(Output)) ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            if (-1 == Child) {
+                llvm::errs() << "constantine: can't start worker process\n";
+                Success = false;
+                break;
+            }
+            Children.push_back(Child);
+        }
+        // when not all workers were started, the run is failed already. the
+        // started ones are stopped, instead of letting them finish the work.
+        if (! Success) {
+            for (std::vector<pid_t>::const_iterator It(Children.begin()), End(Children.end()); It != End; ++It) {
+                kill(*It, SIGTERM);
+            }
+        }
+        for (std::vector<pid_t>::const_iterator It(Children.begin()), End(Children.end()); It != End; ++It) {
+            int Status = 0;
+            if ((-1 == waitpid(*It, &Status, 0)) || (! WIFEXITED(Status)) || (EXIT_SUCCESS != WEXITSTATUS(Status))) {
+                Success = false;
+            }
+        }
+        for (std::vector<std::FILE *>::const_iterator It(Outputs.begin()), End(Outputs.end()); It != End; ++It) {
+            Read(*It, Result);
+            std::fclose(*It);
+        }
+        munmap(Next, sizeof(unsigned));
+        return Success;
+    }
+
+private:
+    bool Execute(unsigned & Next, int const Output) const {
+        llvm::raw_fd_ostream Out(Output, false);
+        AnalysisActionFactory Factory(Settings, Out);
+
+        bool Success = true;
+        for (unsigned It = __sync_fetch_and_add(&Next, 1); It < Files.size(); It = __sync_fetch_and_add(&Next, 1)) {
+            clang::tooling::ClangTool Tool(Compilations, Files[It]);
+            if (0 != Tool.run(&Factory)) {
+                Success = false;
+            }
+            Out.flush();
+        }
+        return Success;
+    }
+
+    static void Read(std::FILE * const Input, std::set<Finding> & Result) {
+        std::rewind(Input);
+
+        char * Buffer = 0;
+        size_t Size = 0;
+        ssize_t Length = 0;
+        while (0 < (Length = getline(&Buffer, &Size, Input))) {
+            std::string const Line(Buffer, ('\n' == Buffer[Length - 1]) ? (Length - 1) : Length);
+
+            std::vector<std::string> Fields;
+            for (std::string::size_type Begin = 0, End = 0; Fields.size() < 5; Begin = End + 1) {
+                End = (Fields.size() < 4) ? Line.find('\t', Begin) : std::string::npos;
+                Fields.push_back(Line.substr(Begin, End - Begin));
+                if (std::string::npos == End)
+                    break;
+            }
+            if (5 != Fields.size()) {
+                continue;
+            }
+            Finding F;
+            F.File = Fields[0];
+            F.Line = std::strtoul(Fields[1].c_str(), 0, 10);
+            F.Column = std::strtoul(Fields[2].c_str(), 0, 10);
+            F.Level = Fields[3];
+            F.Message = Fields[4];
+            Result.insert(F);
+        }
+        std::free(Buffer);
+    }
+
+private:
+    clang::tooling::CompilationDatabase const & Compilations;
+    std::vector<std::string> const & Files;
+    Options const & Settings;
+};
+
+unsigned GetJobs() {
+    if (0 != Jobs) {
+        return Jobs;
+    }
+    long const Processors = sysconf(_SC_NPROCESSORS_ONLN);
+    return (0 < Processors) ? Processors : 1;
+}
+
+} // namespace anonymous
+
+
+int main(int argc, char const * argv[]) {
+    llvm::cl::ParseCommandLineOptions(argc, argv, "constantine - pseudo const analysis\n");
+
+    std::string Error;
+    llvm::OwningPtr<clang::tooling::CompilationDatabase> const Compilations(
+        clang::tooling::CompilationDatabase::loadFromDirectory(BuildPath, Error));
+    if (! Compilations) {
+        llvm::errs() << "constantine: " << Error << '\n';
+        return EXIT_FAILURE;
+    }
+
+    SourceFilter Filter(Includes, Excludes, SystemHeaders);
+    if (! Filter.IsValid(Error)) {
+        llvm::errs() << "constantine: invalid file pattern: " << Error << '\n';
+        return EXIT_FAILURE;
+    }
+    for (std::vector<std::string>::const_iterator It(Checks.begin()), End(Checks.end()); It != End; ++It) {
+        if (! ReportSink::IsRule(*It)) {
+            llvm::errs() << "constantine: unknown check: " << *It << '\n';
+            return EXIT_FAILURE;
+        }
+    }
+    Options Settings;
+    Settings.Filter = &Filter;
+    Settings.CacheDirectory = CacheDirectory;
+    Settings.Instantiations = Instantiations;
+    Settings.Checks.assign(Checks.begin(), Checks.end());
+    Settings.Streaming = Streaming;
+
+    std::vector<std::string> const Files =
+        SourcePaths.empty() ? Compilations->getAllFiles() : SourcePaths;
+
+    std::set<Finding> Findings;
+    Workers const Analysis(*Compilations, Files, Settings);
+    bool const Success = Analysis.Run(std::min<unsigned>(GetJobs(), Files.size()), Findings);
+
+    for (std::set<Finding>::const_iterator It(Findings.begin()), End(Findings.end()); It != End; ++It) {
+        llvm::outs() << It->File << ':' << It->Line << ':' << It->Column << ": "
+                     << It->Level << ": " << It->Message << '\n';
+    }
+    return Success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
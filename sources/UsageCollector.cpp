@@ -1,28 +1,133 @@
 // This file is distributed under MIT-LICENSE. See COPYING for details.
 
+#define DEBUG_TYPE "constantine"
+
 #include "UsageCollector.hpp"
-#include "IsCXXThisExpr.hpp"
+#include "DeclarationCollector.hpp"
+#include "SourceFilter.hpp"
+
+#include <new>
+#include <utility>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/Statistic.h>
 
 #include <boost/bind.hpp>
 #include <boost/range.hpp>
 #include <boost/range/adaptor/filtered.hpp>
 #include <boost/range/algorithm/for_each.hpp>
 
+STATISTIC(NumLvalues, "Number of lvalues resolved to declarations");
+
 namespace {
 
-// Usage extract method implemented in visitor style.
-class UsageExtractor
-    : public boost::noncopyable
-    , public clang::RecursiveASTVisitor<UsageExtractor> {
+// Without tracked variables everything is recorded.
+bool IsTracked(Variables const * const Tracked, clang::DeclaratorDecl const * const D) {
+    return (! Tracked)
+        || clang::isa<clang::FieldDecl>(D)
+        || clang::isa<clang::CXXMethodDecl>(D)
+        || Tracked->count(D);
+}
+
+// Find the declarations which are mutated through the given lvalue. It
+// walks down only on the path to the mutated object, instead of visiting
+// the whole expression. (So array indexes or call arguments on the way are
+// not considered as mutated.) Both branches of a conditional operator are
+// followed.
+//
+// Every declaration on the path is registered. The first one gets the
+// type of the outermost cast or pointer operation, unless the caller gave
+// the type explicitly. The declarations behind a cast, which might cast
+// away the constness, are registered even if those are not tracked.
+class LvalueBaseResolver
+    : public boost::noncopyable {
 public:
-    UsageExtractor(ScopeAnalysis::UsageRefsMap & Out, clang::QualType const & InType)
+    LvalueBaseResolver(ScopeAnalysis::UsageRefsMap & Out, llvm::BumpPtrAllocator & InArena, Variables const * const InTracked)
         : boost::noncopyable()
-        , clang::RecursiveASTVisitor<UsageExtractor>()
         , Results(Out)
-        , WorkingType(InType)
+        , Arena(InArena)
+        , Tracked(InTracked)
+        , WorkingType()
+        , ConstCast(false)
     { }
 
+    void Resolve(clang::Expr const * const In, clang::QualType const & InType) {
+        ConstCast = false;
+        llvm::SmallVector<std::pair<clang::Expr const *, clang::QualType>, 2> Works;
+        Works.push_back(std::make_pair(In, InType));
+
+        while (! Works.empty()) {
+            clang::Expr const * E = Works.back().first;
+            WorkingType = Works.back().second;
+            Works.pop_back();
+
+            while (E) {
+                if (clang::DeclRefExpr const * const DRE = clang::dyn_cast<clang::DeclRefExpr const>(E)) {
+                    AddToUsageMap(DRE->getDecl(), DRE->getType(), DRE->getSourceRange());
+                    break;
+                }
+                if (clang::MemberExpr const * const ME = clang::dyn_cast<clang::MemberExpr const>(E)) {
+                    AddToUsageMap(ME->getMemberDecl(), ME->getType(), ME->getSourceRange());
+                    E = ME->getBase();
+                    continue;
+                }
+                if (clang::AbstractConditionalOperator const * const ACO = clang::dyn_cast<clang::AbstractConditionalOperator const>(E)) {
+                    Works.push_back(std::make_pair(ACO->getFalseExpr(), WorkingType));
+                    E = ACO->getTrueExpr();
+                    continue;
+                }
+                if (clang::BinaryOperator const * const BO = clang::dyn_cast<clang::BinaryOperator const>(E)) {
+                    E = GetMutatedOperand(BO);
+                    continue;
+                }
+                if (clang::CXXMemberCallExpr const * const MCE = clang::dyn_cast<clang::CXXMemberCallExpr const>(E)) {
+                    E = MCE->getImplicitObjectArgument();
+                    continue;
+                }
+                if (clang::CXXOperatorCallExpr const * const OCE = clang::dyn_cast<clang::CXXOperatorCallExpr const>(E)) {
+                    E = GetObjectArgument(OCE);
+                    continue;
+                }
+                if (clang::CastExpr const * const CE = clang::dyn_cast<clang::CastExpr const>(E)) {
+                    SetType(CE->getType());
+                    if (clang::isa<clang::CXXConstCastExpr>(CE) || clang::isa<clang::CStyleCastExpr>(CE)) {
+                        ConstCast = true;
+                    }
+                } else if (clang::UnaryOperator const * const UO = clang::dyn_cast<clang::UnaryOperator const>(E)) {
+                    switch (UO->getOpcode()) {
+                    case clang::UO_AddrOf:
+                    case clang::UO_Deref:
+                        SetType(UO->getType());
+                    default:
+                        ;
+                    }
+                }
+                E = StripOnce(E);
+            }
+        }
+    }
+
 private:
+    // The result of an assignment is the left hand side, the result of
+    // the pointer arithmetic is the pointer operand.
+    static clang::Expr const * GetMutatedOperand(clang::BinaryOperator const * const E) {
+        if (E->isAssignmentOp()) {
+            return E->getLHS();
+        }
+        if (E->isCommaOp()) {
+            return E->getRHS();
+        }
+        if (E->isAdditiveOp()) {
+            if (E->getLHS()->getType()->isPointerType()) {
+                return E->getLHS();
+            }
+            if (E->getRHS()->getType()->isPointerType()) {
+                return E->getRHS();
+            }
+        }
+        return 0;
+    }
+
     void SetType(clang::QualType const & In) {
         static clang::QualType const Empty = clang::QualType();
 
@@ -41,71 +146,55 @@ private:
         SetType(Type);
         if (clang::DeclaratorDecl const * const D =
                 clang::dyn_cast<clang::DeclaratorDecl const>(Decl->getCanonicalDecl())) {
-            ScopeAnalysis::UsageRefsMap::iterator It = Results.find(D);
-            if (Results.end() == It) {
-                std::pair<ScopeAnalysis::UsageRefsMap::iterator, bool> const R =
-                    Results.insert(ScopeAnalysis::UsageRefsMap::value_type(D, ScopeAnalysis::UsageRefs()));
-                It = R.first;
+            if ((! ConstCast) && (! IsTracked(Tracked, D))) {
+                WorkingType = clang::QualType();
+                return;
             }
-            ScopeAnalysis::UsageRefs & Ls = It->second;
-            Ls.push_back(ScopeAnalysis::UsageRef(WorkingType, Location));
+            ScopeAnalysis::UsageRefNode * const Node =
+                new (Arena.Allocate<ScopeAnalysis::UsageRefNode>())
+                    ScopeAnalysis::UsageRefNode(ScopeAnalysis::UsageRef(WorkingType, Location));
+            // the map value is zero initialized on the first insert.
+            ScopeAnalysis::UsageRefs & Ls = Results[D];
+            if (Ls.Last) {
+                Ls.Last->Next = Node;
+            } else {
+                Ls.First = Node;
+            }
+            Ls.Last = Node;
         }
         WorkingType = clang::QualType();
     }
 
-public:
-    // public visitor method.
-    bool VisitCastExpr(clang::CastExpr const * const E) {
-        SetType(E->getType());
-        return true;
-    }
-
-    bool VisitUnaryOperator(clang::UnaryOperator const * const E) {
-        switch (E->getOpcode()) {
-        case clang::UO_AddrOf:
-        case clang::UO_Deref:
-            SetType(E->getType());
-        default:
-            ;
-        }
-        return true;
-    }
-
-    bool VisitDeclRefExpr(clang::DeclRefExpr const * const E) {
-        AddToUsageMap(E->getDecl(), E->getType(), E->getSourceRange());
-        return true;
-    }
-
-    bool VisitMemberExpr(clang::MemberExpr const * const E) {
-        AddToUsageMap(E->getMemberDecl(), E->getType(), E->getSourceRange());
-        return true;
-    }
-
 private:
     ScopeAnalysis::UsageRefsMap & Results;
+    llvm::BumpPtrAllocator & Arena;
+    Variables const * const Tracked;
     clang::QualType WorkingType;
+    bool ConstCast;
 };
 
 // helper method not to be so verbose.
-struct IsItFromMainModule {
-    bool operator()(clang::Decl const * const D) const {
-        clang::SourceManager const & SM = D->getASTContext().getSourceManager();
-        return SM.isFromMainFile(D->getLocation());
-    }
+struct IsItAnalysed {
+    IsItAnalysed(AnalysedFiles & InFiles)
+        : Files(&InFiles)
+    { }
+
     bool operator()(ScopeAnalysis::UsageRefsMap::value_type const & Var) const {
-        return this->operator()(Var.first);
+        return Files->Contains(Var.first);
     }
+
+private:
+    AnalysedFiles * Files;
 };
 
 void DumpUsageMapEntry( ScopeAnalysis::UsageRefsMap::value_type const & Var
            , char const * const Message
            , clang::DiagnosticsEngine & DE) {
     unsigned const Id = DE.getCustomDiagID(clang::DiagnosticsEngine::Note, Message);
-    ScopeAnalysis::UsageRefs const & Ls = Var.second;
-    for (ScopeAnalysis::UsageRefs::const_iterator It(Ls.begin()), End(Ls.end()); It != End; ++It) {
-        clang::DiagnosticBuilder const DB = DE.Report(It->second.getBegin(), Id);
+    for (ScopeAnalysis::UsageRefNode const * It = Var.second.First; It; It = It->Next) {
+        clang::DiagnosticBuilder const DB = DE.Report(It->Ref.second.getBegin(), Id);
         DB << Var.first->getNameAsString();
-        DB << It->first.getAsString();
+        DB << It->Ref.first.getAsString();
         DB.setForceEmit();
     }
 }
@@ -113,22 +202,23 @@ void DumpUsageMapEntry( ScopeAnalysis::UsageRefsMap::value_type const & Var
 } // namespace anonymous
 
 
-UsageCollector::UsageCollector(ScopeAnalysis::UsageRefsMap & Out)
+UsageCollector::UsageCollector(ScopeAnalysis::UsageRefsMap & Out, llvm::BumpPtrAllocator & InArena, Variables const * const InTracked)
     : boost::noncopyable()
     , Results(Out)
+    , Arena(InArena)
+    , Tracked(InTracked)
 { }
 
 UsageCollector::~UsageCollector()
 { }
 
 void UsageCollector::AddToResults(clang::Expr const * E, clang::QualType const & Type) {
-    clang::Stmt const * const Stmt = E;
-
-    UsageExtractor Visitor(Results, Type);
-    Visitor.TraverseStmt(const_cast<clang::Stmt*>(Stmt));
+    ++NumLvalues;
+    LvalueBaseResolver Resolver(Results, Arena, Tracked);
+    Resolver.Resolve(E, Type);
 }
 
-void UsageCollector::Report(char const * const M, clang::DiagnosticsEngine & DE) const {
-    boost::for_each(Results | boost::adaptors::filtered(IsItFromMainModule()),
+void UsageCollector::Report(ScopeAnalysis::UsageRefsMap const & Results, char const * const M, clang::DiagnosticsEngine & DE, AnalysedFiles & Files) {
+    boost::for_each(Results | boost::adaptors::filtered(IsItAnalysed(Files)),
         boost::bind(DumpUsageMapEntry, _1, M, boost::ref(DE)));
 }
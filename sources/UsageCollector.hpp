@@ -7,25 +7,27 @@
 
 #include <boost/noncopyable.hpp>
 #include <clang/AST/AST.h>
-#include <clang/AST/RecursiveASTVisitor.h>
 
 
 // Collect variable usages. One variable could have been used multiple
 // times with different constness of the given type.
 class UsageCollector
     : public boost::noncopyable {
+public:
+    static void Report(ScopeAnalysis::UsageRefsMap const &, char const * const Message, clang::DiagnosticsEngine &, AnalysedFiles &);
+
 protected:
-    UsageCollector(ScopeAnalysis::UsageRefsMap & Out);
+    UsageCollector(ScopeAnalysis::UsageRefsMap & Out, llvm::BumpPtrAllocator & Arena, Variables const * Tracked);
     virtual ~UsageCollector();
 
     void AddToResults(
             clang::Expr const * const Stmt,
             clang::QualType const & Type = clang::QualType());
 
-    void Report(char const * const Message, clang::DiagnosticsEngine &) const;
-
 private:
     ScopeAnalysis::UsageRefsMap & Results;
+    llvm::BumpPtrAllocator & Arena;
+    Variables const * const Tracked;
 };
 
 #endif // _UsageCollector_hpp_
@@ -0,0 +1,11 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Cached -plugin-arg-constantine -constantine-cache=%t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Cached -plugin-arg-constantine -constantine-cache=%t
+
+// The second run takes the analysis of the header from the cache.
+#include "Inputs/Cached.hpp"
+
+void test_1() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const k = i;
+}
@@ -0,0 +1,28 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %s %t/Unit.cpp
+// RUN: %clang_cc1 %t/Unit.cpp -fsyntax-only -verify -plugin-arg-constantine -constantine-cache=%t/cache
+// RUN: sed -e 's|/\* EDIT \*/|++i;|' -e 's|// expected-[w]arning.*EDITED||' %s > %t/Unit.cpp
+// RUN: %clang_cc1 %t/Unit.cpp -fsyntax-only -verify -plugin-arg-constantine -constantine-cache=%t/cache
+
+// The second run analyses only the edited function, the others are
+// restored from the cache.
+void test_1() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const k = i;
+}
+
+void test_2() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}} EDITED
+    /* EDIT */
+}
+
+struct A {
+    int get() { // expected-warning {{function 'get' could be declared as const}}
+        return m;
+    }
+    void set(int const v) {
+        m = v;
+    }
+
+    int m;
+};
@@ -0,0 +1,23 @@
+class Counter {
+public:
+    Counter() : count(0), limit(10) { }
+
+    void increment() {
+        ++count;
+    }
+    int get() { // expected-warning {{function 'get' could be declared as const}}
+        return count;
+    }
+    int twice(int const i) { // expected-warning {{function 'twice' could be declared as static}}
+        return i * 2;
+    }
+
+private:
+    int count;
+    int limit; // expected-warning {{variable 'limit' could be declared as const}}
+};
+
+inline int header_test() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    return i;
+}
@@ -0,0 +1,10 @@
+inline int shared_test() {
+#ifdef SECOND
+    int j = 1; // expected-warning {{variable 'j' could be declared as const}}
+    int i = j;
+    ++i;
+#else
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+#endif
+    return i;
+}
@@ -0,0 +1,32 @@
+// RUN: rm -rf %t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-cache=%t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -DCHANGE -plugin-arg-constantine -constantine-cache=%t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-cache=%t
+
+// The source text of the functions is the same in every run, but the
+// defines change the meaning of them, so they are analysed again.
+#ifdef CHANGE
+#define TOUCH(X) ++X
+void touch(int &);
+#else
+#define TOUCH(X) X
+void touch(int);
+#endif
+
+void test_1() {
+#ifndef CHANGE
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+#else
+    int i = 0;
+#endif
+    TOUCH(i);
+}
+
+void test_2() {
+#ifndef CHANGE
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+#else
+    int i = 0;
+#endif
+    touch(i);
+}
@@ -0,0 +1,12 @@
+// REQUIRES: asserts
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-cache=%t/cache
+// RUN: %clang_cc1 %s -fsyntax-only -verify -DSECOND -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-cache=%t/cache
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-cache=%t/cache -plugin-arg-constantine -constantine-stats 2> %t/first.txt
+// RUN: grep " 1 constantine - Number of function analyses restored from the cache" %t/first.txt
+// RUN: %clang_cc1 %s -fsyntax-only -DSECOND -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-cache=%t/cache -plugin-arg-constantine -constantine-stats 2> %t/second.txt
+// RUN: grep " 1 constantine - Number of function analyses restored from the cache" %t/second.txt
+
+// The two translation units see the header differently, the cache keeps
+// the entries of both.
+#include "Inputs/Shared.hpp"
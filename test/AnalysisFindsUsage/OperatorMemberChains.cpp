@@ -0,0 +1,28 @@
+// RUN: %clang_cc1 %usage %s -fsyntax-only -verify
+
+// ..:: fixtures ::..
+struct Inner {
+    int x;
+};
+
+struct SmartPointer {
+    Inner * operator->() const;
+};
+
+struct Vector {
+    Inner & operator[](int) const;
+};
+// ..:: fixtures ::..
+
+struct Outer {
+    SmartPointer sp;
+    Vector v;
+
+    int through_smart_pointer() const {
+        return this->sp->x; // expected-note {{symbol 'x' was used}} // expected-note 2 {{symbol 'sp' was used}} // expected-note {{symbol 'operator->' was used}}
+    }
+
+    int through_subscript() const {
+        return this->v[0].x; // expected-note {{symbol 'x' was used}} // expected-note 2 {{symbol 'v' was used}} // expected-note {{symbol 'operator[]' was used}}
+    }
+};
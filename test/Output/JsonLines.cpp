@@ -0,0 +1,12 @@
+// RUN: rm -f %t.jsonl
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=jsonl -plugin-arg-constantine -constantine-output=%t.jsonl
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=jsonl -plugin-arg-constantine -constantine-output=%t.jsonl
+// RUN: grep -c '"rule":"variable-const","level":"warning","name":"i"' %t.jsonl | grep -x 2
+// RUN: grep -c '"line":10,"column":5}$' %t.jsonl | grep -x 2
+
+void test_1() {
+    // the findings of both runs are appended.
+    int const k = 0;
+    int i = k;
+    int const j = i;
+}
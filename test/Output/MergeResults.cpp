@@ -0,0 +1,20 @@
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-format=binary -plugin-arg-constantine -constantine-output=%t.1.cnst
+// RUN: %clang_cc1 %s -fsyntax-only -DSECOND -plugin-arg-constantine -constantine-include=Inputs/Shared -plugin-arg-constantine -constantine-format=binary -plugin-arg-constantine -constantine-output=%t.2.cnst
+// RUN: %constantine_merge %t.1.cnst %t.2.cnst -o %t.txt
+// RUN: grep -c "Inputs/Shared.hpp:2:5: warning: variable 'i' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c "MergeResults.cpp:11:5: warning: variable 'j' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c "MergeResults.cpp:16:5: warning: variable 'k' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c . %t.txt | grep -x 3
+#include "Inputs/Shared.hpp"
+
+void test_1() {
+    int j = shared();
+    int const l = j;
+}
+
+#ifdef SECOND
+void test_2() {
+    int k = 0;
+    int const l = k;
+}
+#endif
@@ -0,0 +1,13 @@
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=sarif -plugin-arg-constantine -constantine-output=%t.sarif
+// RUN: grep '"version":"2.1.0"' %t.sarif
+// RUN: grep '"ruleId":"function-static","level":"warning","message":{"text":"function .f. could be declared as static"}' %t.sarif
+// RUN: grep '"startLine":10,"startColumn":5}' %t.sarif
+// RUN: grep '"uri":"file:///[^"]*/Sarif.cpp"' %t.sarif
+// RUN: tail -n 1 %t.sarif | grep -x -F ']}]}'
+
+class A {
+public:
+    int f() {
+        return 1;
+    }
+};
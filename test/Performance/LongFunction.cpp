@@ -0,0 +1,29 @@
+// RUN: %budget --time=4 --memory=2 %clang_plain %s -fsyntax-only -- %clang_cc1 %s -fsyntax-only
+
+// A function with fifty thousand statements.
+
+#define D10(M, P) M(P##0) M(P##1) M(P##2) M(P##3) M(P##4) M(P##5) M(P##6) M(P##7) M(P##8) M(P##9)
+#define D100(M, P) D10(M, P##0) D10(M, P##1) D10(M, P##2) D10(M, P##3) D10(M, P##4) D10(M, P##5) D10(M, P##6) D10(M, P##7) D10(M, P##8) D10(M, P##9)
+#define D1000(M, P) D100(M, P##0) D100(M, P##1) D100(M, P##2) D100(M, P##3) D100(M, P##4) D100(M, P##5) D100(M, P##6) D100(M, P##7) D100(M, P##8) D100(M, P##9)
+#define D5000(M) D1000(M, 1) D1000(M, 2) D1000(M, 3) D1000(M, 4) D1000(M, 5)
+
+#define STATEMENTS(N) \
+    total += step; \
+    if (limit < total) step = N % 7; \
+    values[N % 8] = total; \
+    total -= values[N % 4]; \
+    step += total; \
+    total ^= step; \
+    step -= limit; \
+    if (total < 0) total = -total; \
+    step = (step + N) % limit; \
+    total = total % limit;
+
+int sum() {
+    int total = 0;
+    int step = 1;
+    int const limit = 1000;
+    int values[8] = { 0 };
+    D5000(STATEMENTS)
+    return total;
+}
@@ -0,0 +1,21 @@
+// RUN: %budget --time=4 --memory=2 %clang_plain %s -fsyntax-only -- %clang_cc1 %s -fsyntax-only
+
+// A class with a thousand member variables and two thousand methods.
+// Every method is checked against every member.
+
+#define D10(M, P) M(P##0) M(P##1) M(P##2) M(P##3) M(P##4) M(P##5) M(P##6) M(P##7) M(P##8) M(P##9)
+#define D100(M, P) D10(M, P##0) D10(M, P##1) D10(M, P##2) D10(M, P##3) D10(M, P##4) D10(M, P##5) D10(M, P##6) D10(M, P##7) D10(M, P##8) D10(M, P##9)
+#define D1000(M) D100(M, 0) D100(M, 1) D100(M, 2) D100(M, 3) D100(M, 4) D100(M, 5) D100(M, 6) D100(M, 7) D100(M, 8) D100(M, 9)
+
+#define MEMBER(N) int m##N;
+#define GETTER(N) int get##N() const { return m##N; }
+#define SETTER(N) void set##N(int const v) { m##N = v; }
+
+class Big {
+public:
+    D1000(GETTER)
+    D1000(SETTER)
+
+private:
+    D1000(MEMBER)
+};
@@ -0,0 +1,30 @@
+// RUN: %budget --time=4 --memory=2 %clang_plain %s -fsyntax-only -- %clang_cc1 %s -fsyntax-only
+
+// Member accesses 64 levels deep, and references into the middle of the
+// chains.
+
+#define D10(M, P) M(P##0) M(P##1) M(P##2) M(P##3) M(P##4) M(P##5) M(P##6) M(P##7) M(P##8) M(P##9)
+#define D100(M, P) D10(M, P##0) D10(M, P##1) D10(M, P##2) D10(M, P##3) D10(M, P##4) D10(M, P##5) D10(M, P##6) D10(M, P##7) D10(M, P##8) D10(M, P##9)
+#define D1000(M) D100(M, 0) D100(M, 1) D100(M, 2) D100(M, 3) D100(M, 4) D100(M, 5) D100(M, 6) D100(M, 7) D100(M, 8) D100(M, 9)
+
+#define N8 .Next.Next.Next.Next.Next.Next.Next.Next
+#define N32 N8 N8 N8 N8
+
+template <int N>
+struct Level {
+    Level<N - 1> Next;
+};
+
+template <>
+struct Level<0> {
+    int Value;
+};
+
+#define CHAIN(N) Root N32 N32 .Value += 1;
+#define REFERENCE(N) Level<32> & r##N = Root N32; r##N N32 .Value = 1;
+
+void chains() {
+    Level<64> Root;
+    D1000(CHAIN)
+    D1000(REFERENCE)
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python
+# This file is distributed under MIT-LICENSE. See COPYING for details.
+
+"""Fails when a command is too slow or too big compared to a baseline.
+
+    budget.py [--time=RATIO] [--memory=RATIO] BASELINE ... -- MEASURED ...
+
+Both commands run a few times, the best CPU time (the user and system time
+of the child) and the peak RSS are compared. The time budget has a fixed
+slack, so short runs are not failing because of the noise of the machine.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import subprocess
+import sys
+
+SLACK_SECONDS = 0.5
+
+
+def measure(command, repeat):
+    best_time, peak_rss = None, 0
+    with open(os.devnull, 'w') as devnull:
+        for _ in range(repeat):
+            child = subprocess.Popen(command, stdout=devnull, stderr=devnull)
+            _, status, usage = os.wait4(child.pid, 0)
+            elapsed = usage.ru_utime + usage.ru_stime
+            if not os.WIFEXITED(status) or os.WEXITSTATUS(status):
+                print('failed: {0}'.format(' '.join(command)))
+                sys.exit(1)
+            best_time = elapsed if best_time is None else min(best_time, elapsed)
+            peak_rss = max(peak_rss, usage.ru_maxrss)
+    return best_time, peak_rss
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--time', type=float, default=4.0)
+    parser.add_argument('--memory', type=float, default=2.0)
+    parser.add_argument('--repeat', type=int, default=3)
+    parser.add_argument('commands', nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+
+    commands = args.commands
+    if '--' not in commands:
+        parser.error('the baseline and the measured command are separated by --')
+    split = commands.index('--')
+    baseline, measured = commands[:split], commands[split + 1:]
+
+    base_time, base_rss = measure(baseline, args.repeat)
+    time_used, rss_used = measure(measured, args.repeat)
+    time_budget = base_time * args.time + SLACK_SECONDS
+    rss_budget = base_rss * args.memory
+
+    print('time: {0:.3f}s (baseline {1:.3f}s, budget {2:.3f}s)'.format(
+        time_used, base_time, time_budget))
+    print('memory: {0}kB (baseline {1}kB, budget {2:.0f}kB)'.format(
+        rss_used, base_rss, rss_budget))
+    if time_budget < time_used or rss_budget < rss_used:
+        print('over budget')
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
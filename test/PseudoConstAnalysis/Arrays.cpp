@@ -15,3 +15,15 @@ void test_3() {
     int i[] = { 0, 1, 2 }; // expected-warning {{variable 'i' could be declared as const}}
     int const k = i[0];
 }
+
+void test_4() {
+    int i[] = { 0, 1, 2 };
+    int k = 0; // expected-warning {{variable 'k' could be declared as const}}
+    i[k] = 1;
+}
+
+void test_5() {
+    int i[] = { 0, 1, 2 };
+    int k = 0;
+    i[k++] = 1;
+}
@@ -0,0 +1,17 @@
+struct A {
+    int m;
+
+    int get();
+    void set(int);
+};
+
+inline int twice(int i) {
+    return i * 2;
+}
+
+template <typename T>
+T scaled(T t, int const n) {
+    T result = t;
+    result *= n;
+    return result;
+}
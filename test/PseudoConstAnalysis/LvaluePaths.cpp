@@ -0,0 +1,36 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+
+// ..:: fixtures ::..
+struct Vector {
+    int & at(int);
+    int & operator[](int);
+};
+
+int & at(int *, int);
+// ..:: fixtures ::..
+
+void call_arguments_are_not_changed() {
+    Vector v;
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    v.at(i) = 1;
+    v[i] = 2;
+}
+
+void free_call_arguments_are_not_changed() {
+    int a[] = { 0, 1, 2 };
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    at(a, i) = 1;
+}
+
+void both_branches_are_changed(bool const c) {
+    int i = 0;
+    int j = 0;
+    (c ? i : j) = 1;
+}
+
+void only_the_branches_are_changed(bool const c) {
+    int i = 0;
+    int j = 0;
+    int k = 0; // expected-warning {{variable 'k' could be declared as const}}
+    (c ? i : j) = k;
+}
@@ -0,0 +1,60 @@
+// RUN: rm -f %t.serial.jsonl %t.4.jsonl %t.64.jsonl
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=jsonl -plugin-arg-constantine -constantine-output=%t.serial.jsonl
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=jsonl -plugin-arg-constantine -constantine-output=%t.4.jsonl -plugin-arg-constantine -constantine-jobs=4
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-format=jsonl -plugin-arg-constantine -constantine-output=%t.64.jsonl -plugin-arg-constantine -constantine-jobs=64
+// RUN: grep '"rule":"variable-const","level":"warning","name":"unchanged"' %t.serial.jsonl
+// RUN: diff %t.serial.jsonl %t.4.jsonl
+// RUN: diff %t.serial.jsonl %t.64.jsonl
+
+// The findings of the threads are merged into the same result as the
+// serial analysis gives, for members which are shared by many methods.
+
+struct Base {
+    int changed;
+    int unchanged;
+
+    int get() {
+        return unchanged;
+    }
+
+    void set(int const v) {
+        changed = v;
+    }
+};
+
+struct Derived : public Base {
+    int own;
+
+    int sum() {
+        return own + get();
+    }
+
+    void reset() {
+        changed = 0;
+    }
+
+    static int twice(int i) {
+        return i * 2;
+    }
+};
+
+struct Other {
+    Derived * target;
+    int unused;
+
+    void poke() {
+        target->own = 1;
+    }
+
+    int peek() {
+        int & r = unused;
+        return r;
+    }
+};
+
+void test_1(Other & o) {
+    int i = 0;
+    int j = i;
+    o.poke();
+    ++j;
+}
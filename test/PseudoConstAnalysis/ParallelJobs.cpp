@@ -0,0 +1,45 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-jobs=4
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-jobs=64
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-jobs=4 -plugin-arg-constantine -constantine-streaming
+
+struct TestType {
+    int changed;
+    int unchanged; // expected-warning {{variable 'unchanged' could be declared as const}}
+
+    TestType();
+
+    int f1() { // expected-warning {{function 'f1' could be declared as const}}
+        return unchanged;
+    }
+
+    void f2() {
+        ++changed;
+    }
+
+    int f3() { // expected-warning {{function 'f3' could be declared as const}}
+        return changed;
+    }
+
+    int f4() { // expected-warning {{function 'f4' could be declared as static}}
+        return 4;
+    }
+};
+
+void test_1() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const k = i;
+}
+
+void test_2() {
+    int i = 0;
+    int & k = i;
+    ++k;
+}
+
+int test_3(int i) { // expected-warning {{variable 'i' could be declared as const}}
+    return i;
+}
+
+int test_4(int i) {
+    return ++i;
+}
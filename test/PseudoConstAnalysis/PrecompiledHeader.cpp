@@ -0,0 +1,24 @@
+// RUN: %clang_plain -x c++-header %S/Inputs/Precompiled.hpp -emit-pch -o %t.pch
+// RUN: %clang_cc1 %s -include-pch %t.pch -fsyntax-only -verify
+// RUN: %clang_cc1 %s -include-pch %t.pch -fsyntax-only -verify -plugin-arg-constantine -constantine-jobs=4 -plugin-arg-constantine -constantine-instantiations
+
+// With multiple jobs the declarations of the header are loaded before the
+// functions are analysed on the threads.
+
+int A::get() { // expected-warning {{function 'get' could be declared as const}}
+    return m;
+}
+
+void A::set(int const v) {
+    m = v;
+}
+
+int test() {
+    int i = twice(1); // expected-warning {{variable 'i' could be declared as const}}
+    return i;
+}
+
+int test_scaled() {
+    int j = scaled(2, 3); // expected-warning {{variable 'j' could be declared as const}}
+    return j;
+}
@@ -0,0 +1,25 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+
+void mutating_through_const_reference() {
+    int i = 0;
+    int const & k = i;
+    const_cast<int &>(k) = 1;
+}
+
+void mutating_through_const_pointer() {
+    int i = 0;
+    int const * const p = &i;
+    *const_cast<int *>(p) = 1;
+}
+
+void mutating_through_c_style_cast() {
+    int i = 0;
+    int const & k = i;
+    ++((int &)k);
+}
+
+void reading_through_const_reference() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const & k = i;
+    int const j = k;
+}
@@ -0,0 +1,37 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+
+void test_1() {
+    int i = 0;
+    int j = 0; // expected-warning {{variable 'j' could be declared as const}}
+    int & k = i;
+    int * const p = &k;
+    int * const q = &k;
+    int & l = j; // expected-warning {{variable 'l' could be declared as const}}
+
+    ++(*p);
+    ++(*q);
+}
+
+void test_2() {
+    int i = 0;
+    int & k = i; // expected-warning {{variable 'k' could be declared as const}}
+    int * const p = &i;
+
+    ++(*p);
+}
+
+struct TestType {
+    int m_i;
+
+    void mutating_through_chain() {
+        int & i = m_i;
+        int * const j = &i;
+        ++(*j);
+    }
+
+    void mutated_by_value_but_chain_reported() {
+        int & i = m_i; // expected-warning {{variable 'i' could be declared as const}}
+        int * const j = &i;
+        ++m_i;
+    }
+};
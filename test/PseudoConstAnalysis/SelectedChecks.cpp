@@ -0,0 +1,19 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-checks=function-static
+// RUN: %clang_add_plugin %s -emit-llvm-only -verify -plugin-arg-constantine -constantine-checks=function-static
+
+struct A {
+    int m;
+
+    int get() {
+        return m;
+    }
+
+    int twice(int const i) { // expected-warning {{function 'twice' could be declared as static}}
+        return i * 2;
+    }
+};
+
+int test() {
+    int i = 0;
+    return i;
+}
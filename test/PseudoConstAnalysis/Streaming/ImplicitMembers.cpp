@@ -0,0 +1,19 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-streaming
+// expected-no-diagnostics
+
+struct A {
+    int value;
+
+    void set(int const v) {
+        value = v;
+    }
+
+    void assign(A const &);
+};
+
+// the copy assignment is declared at its first use, after the class was
+// parsed and its inline methods were streamed.
+void A::assign(A const & other) {
+    *this = other;
+}
@@ -0,0 +1,23 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-streaming
+
+struct A {
+    int changed;
+    int unchanged; // expected-warning {{variable 'unchanged' could be declared as const}}
+
+    int get() const;
+    void set(int);
+};
+
+int test_1(A const & a) {
+    int i = a.get(); // expected-warning {{variable 'i' could be declared as const}}
+    return i;
+}
+
+int A::get() const {
+    return unchanged + changed;
+}
+
+// the member is changed after the other methods were analysed.
+void A::set(int const v) {
+    changed = v;
+}
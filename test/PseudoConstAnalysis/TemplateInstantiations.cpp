@@ -0,0 +1,71 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-instantiations
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-instantiations -plugin-arg-constantine -constantine-streaming
+
+struct Mutable {
+    void touch() {
+        ++n;
+    }
+    int n;
+};
+
+struct Other {
+    void touch() {
+        ++n;
+    }
+    int n;
+};
+
+// 't' is changed by the instantiations only, 'i' is reported once.
+template <typename T>
+int test_1(T t) {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    t.touch();
+    return i;
+}
+
+void use_1() {
+    test_1(Mutable());
+    test_1(Other());
+}
+
+// 'poke' is changing the member in the instantiation.
+template <typename T>
+struct Holder {
+    void poke() {
+        value.touch();
+    }
+    T value;
+};
+
+void use_2() {
+    Holder<Mutable> h;
+    h.poke();
+}
+
+// 'call' is static in the first instantiation, but not in the second one.
+struct Static {
+    static int get() {
+        return 0;
+    }
+};
+
+struct Member {
+    int get() const {
+        return n;
+    }
+    int n; // expected-warning {{variable 'n' could be declared as const}}
+};
+
+template <typename T>
+struct Caller : public T {
+    int call() {
+        return T::get();
+    }
+};
+
+void use_3() {
+    Caller<Static> s;
+    s.call();
+    Caller<Member> m;
+    m.call();
+}
@@ -0,0 +1,20 @@
+// REQUIRES: asserts
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-instantiations
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-instantiations -plugin-arg-constantine -constantine-stats 2> %t.txt
+// RUN: grep " 1 constantine - Number of template instantiations analysed" %t.txt
+// RUN: grep " 2 constantine - Number of template instantiations taken from the pattern memo" %t.txt
+
+// The first instantiation decides 'i' and 't', the others are not
+// analysed.
+template <typename T>
+int test_1(T t) {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    ++t;
+    return i;
+}
+
+void use_1() {
+    test_1(1);
+    test_1(2L);
+    test_1('c');
+}
@@ -0,0 +1,15 @@
+// RUN: %clang_cc1 %change %s -fsyntax-only -verify
+// RUN: %clang_cc1 %change %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Counter -DINCLUDED
+
+#include "Inputs/Counter.hpp"
+
+// the declarations of the not analysed files are not dumped.
+void test_1() {
+    int i = 0;
+    ++i; // expected-note {{variable 'i' with type 'int' was changed}}
+#ifdef INCLUDED
+    ++counter; // expected-note {{variable 'counter' with type 'int' was changed}}
+#else
+    ++counter;
+#endif
+}
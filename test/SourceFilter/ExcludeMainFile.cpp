@@ -0,0 +1,7 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-exclude=ExcludeMainFile
+// expected-no-diagnostics
+
+void test_1() {
+    int i = 0;
+    int const k = i;
+}
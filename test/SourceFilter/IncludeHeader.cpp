@@ -0,0 +1,11 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Header
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Header -plugin-arg-constantine -constantine-exclude=IncludeHeader.cpp -DEXCLUDED
+
+#include "Inputs/Header.hpp"
+
+#ifndef EXCLUDED
+void test_1() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const k = i;
+}
+#endif
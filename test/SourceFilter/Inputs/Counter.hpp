@@ -0,0 +1 @@
+extern int counter;
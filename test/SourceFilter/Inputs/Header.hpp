@@ -0,0 +1,4 @@
+inline int header_test() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    return i;
+}
@@ -0,0 +1,4 @@
+inline int silent_test() {
+    int i = 0;
+    return i;
+}
@@ -0,0 +1,8 @@
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+
+#include "Inputs/Silent.hpp"
+
+void test_1() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const k = i;
+}
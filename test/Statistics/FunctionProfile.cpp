@@ -0,0 +1,21 @@
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-profile=2 2> %t.txt
+// RUN: grep "constantine: the 2 most expensive functions" %t.txt
+// RUN: grep -c "FunctionProfile.cpp:[0-9]*:[0-9]*: '.*' [0-9.]* ms, [0-9]* nodes, [0-9]* references, [0-9]* members" %t.txt | grep -x 2
+
+struct A {
+    int m;
+
+    int get() {
+        return m;
+    }
+};
+
+void test_1() {
+    int i = 0;
+    int const j = i;
+}
+
+void test_2() {
+    int k = 0;
+    k += 1;
+}
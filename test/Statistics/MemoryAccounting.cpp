@@ -0,0 +1,24 @@
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-memory=2 2> %t.txt
+// RUN: grep "constantine: memory of the analysis" %t.txt
+// RUN: grep "candidates and changes: [0-9]* bytes (peak [0-9]* bytes)" %t.txt
+// RUN: grep "member sets: [0-9]* bytes (peak [0-9]* bytes)" %t.txt
+// RUN: grep "constantine: the 2 largest functions" %t.txt
+// RUN: grep -c "MemoryAccounting.cpp:[0-9]*:[0-9]*: '.*' [0-9]* bytes" %t.txt | grep -x 2
+
+struct A {
+    int m;
+
+    int get() {
+        return m;
+    }
+};
+
+void test_1() {
+    int i = 0;
+    int const j = i;
+}
+
+void test_2() {
+    int k = 0;
+    k += 1;
+}
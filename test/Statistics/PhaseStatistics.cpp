@@ -0,0 +1,19 @@
+// REQUIRES: asserts
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-stats 2> %t.txt
+// RUN: grep "2 constantine - Number of functions analysed" %t.txt
+// RUN: grep "1 constantine - Number of records collected" %t.txt
+// RUN: grep "Scope analysis" %t.txt
+// RUN: grep "Declaration collection" %t.txt
+
+struct A {
+    int m;
+
+    int get() {
+        return m;
+    }
+};
+
+void test_1() {
+    int i = 0;
+    int const j = i;
+}
@@ -0,0 +1,33 @@
+// REQUIRES: asserts
+// RUN: %clang_cc1 %s -fsyntax-only -verify
+// RUN: %clang_cc1 %s -fsyntax-only -plugin-arg-constantine -constantine-stats 2> %t.txt
+// RUN: grep "2 constantine - Number of functions skipped without candidates" %t.txt
+// RUN: grep "4 constantine - Number of functions analysed" %t.txt
+
+int test_1(int const i, int const & j, int const * const k) {
+    int const l = i + j + *k;
+    return l;
+}
+
+void test_2(int * const i) {
+    ++(*i);
+}
+
+void test_3() {
+    int i = 0; // expected-warning {{variable 'i' could be declared as const}}
+    int const & j = i;
+}
+
+struct A {
+    int const m;
+
+    A() : m(0) { }
+
+    virtual int get() const {
+        return m;
+    }
+
+    int twice(int const i) const { // expected-warning {{function 'twice' could be declared as static}}
+        return i * 2;
+    }
+};
@@ -0,0 +1,32 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %s %t/first.cpp
+// RUN: cp %S/Inputs/Shared.hpp %t/Shared.hpp
+// RUN: echo '#include "Shared.hpp"' > %t/second.cpp
+// RUN: echo 'int broken(' > %t/broken.cpp
+// RUN: echo '[{"directory":"%t","command":"clang++ -fsyntax-only first.cpp","file":"%t/first.cpp"},{"directory":"%t","command":"clang++ -fsyntax-only second.cpp","file":"%t/second.cpp"},{"directory":"%t","command":"clang++ -fsyntax-only broken.cpp","file":"%t/broken.cpp"}]' > %t/compile_commands.json
+//
+// the header finding of the two translation units is printed once.
+// RUN: %constantine_tool -p %t -constantine-include=Shared %t/first.cpp %t/second.cpp > %t.txt
+// RUN: grep -c "Shared.hpp:2:5: warning: variable 'i' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c "first.cpp:30:5: warning: variable 'j' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c . %t.txt | grep -x 2
+//
+// the same with parallel workers.
+// RUN: %constantine_tool -p %t -j 2 -constantine-include=Shared %t/first.cpp %t/second.cpp > %t.parallel.txt
+// RUN: diff %t.txt %t.parallel.txt
+//
+// the same with the streaming analysis.
+// RUN: %constantine_tool -p %t -constantine-streaming -constantine-include=Shared %t/first.cpp %t/second.cpp > %t.streaming.txt
+// RUN: diff %t.txt %t.streaming.txt
+//
+// a translation unit which does not compile fails the run.
+// RUN: rm -f %t.failed
+// RUN: %constantine_tool -p %t -j 2 %t/first.cpp %t/broken.cpp > %t.broken.txt || touch %t.failed
+// RUN: test -f %t.failed
+
+#include "Shared.hpp"
+
+int first() {
+    int j = shared();
+    return j;
+}
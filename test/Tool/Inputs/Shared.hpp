@@ -0,0 +1,4 @@
+inline int shared() {
+    int i = 0;
+    return i;
+}
@@ -0,0 +1,30 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: cp %s %t/First.cpp
+// RUN: cp %s %t/Second.cpp
+// RUN: %clang_cc1 %t/First.cpp -I %S -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Fields -plugin-arg-constantine -constantine-field-facts=%t/facts
+// RUN: %clang_cc1 %t/Second.cpp -I %S -fsyntax-only -verify -DSECOND -plugin-arg-constantine -constantine-include=Inputs/Fields -plugin-arg-constantine -constantine-field-facts=%t/facts
+// RUN: %clang_cc1 %t/Second.cpp -I %S -fsyntax-only -verify -DSECOND -plugin-arg-constantine -constantine-include=Inputs/Fields -plugin-arg-constantine -constantine-field-facts=%t/facts
+// RUN: %constantine_fields %t/facts -o %t/before.txt
+// RUN: grep -c "Inputs/Fields.hpp:3:5: warning: variable 'Unchanged' could be declared as const" %t/before.txt | grep -x 1
+// RUN: grep -c . %t/before.txt | grep -x 1
+// RUN: %clang_cc1 %t/Second.cpp -I %S -fsyntax-only -verify -plugin-arg-constantine -constantine-include=Inputs/Fields -plugin-arg-constantine -constantine-field-facts=%t/facts
+// RUN: %constantine_fields %t/facts -o %t/after.txt
+// RUN: grep -c "Inputs/Fields.hpp:2:5: warning: variable 'Count' could be declared as const" %t/after.txt | grep -x 1
+// RUN: grep -c . %t/after.txt | grep -x 2
+
+// The facts of a translation unit are replaced when it is compiled again:
+// the last compilation of 'Second.cpp' does not change 'Count' anymore.
+#include "Inputs/Fields.hpp"
+
+// the member variables are not reported by the translation units.
+#ifndef SECOND
+int Counter::Get() const {
+    int i = Count; // expected-warning {{variable 'i' could be declared as const}}
+    return i + Unchanged;
+}
+#else
+// expected-no-diagnostics
+void Reset(Counter & C) {
+    C.Count = 0;
+}
+#endif
@@ -0,0 +1,6 @@
+struct Counter {
+    int Count;
+    int Unchanged;
+
+    int Get() const;
+};
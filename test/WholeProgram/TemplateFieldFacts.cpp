@@ -0,0 +1,22 @@
+// RUN: rm -rf %t.facts
+// RUN: %clang_cc1 %s -fsyntax-only -verify -plugin-arg-constantine -constantine-instantiations -plugin-arg-constantine -constantine-include=Inputs/Fields -plugin-arg-constantine -constantine-field-facts=%t.facts
+// RUN: %constantine_fields %t.facts -o %t.txt
+// RUN: grep -c "Inputs/Fields.hpp:3:5: warning: variable 'Unchanged' could be declared as const" %t.txt | grep -x 1
+// RUN: grep -c . %t.txt | grep -x 1
+
+// expected-no-diagnostics
+#include "Inputs/Fields.hpp"
+
+int Counter::Get() const {
+    return Count + Unchanged;
+}
+
+// the member of the other class is changed by the instantiation only.
+template <typename T>
+void Reset(T & C) {
+    C.Count = 0;
+}
+
+void ResetCounter(Counter & C) {
+    Reset(C);
+}